@@ -0,0 +1,33 @@
+#include <ESP8266WiFi.h>
+#include "channel_scan.h"
+
+#define SCAN_CHANNEL_COUNT 3
+
+const uint8_t scanChannels[SCAN_CHANNEL_COUNT] = {1, 6, 11};
+
+void startChannelScan() {
+  WiFi.scanNetworks(true, true);
+}
+
+uint8_t leastBusyChannel() {
+  int8_t found = WiFi.scanComplete();
+  if (found == WIFI_SCAN_RUNNING) return 0;
+  if (found < 0) return scanChannels[0]; // scan failed, nothing to go by
+
+  // every access point loads its own channel and the neighbouring ones, the stronger the more
+  uint16_t load[SCAN_CHANNEL_COUNT] = {0};
+  for (int8_t i = 0; i < found; i++) {
+    int32_t apChannel = WiFi.channel(i);
+    uint8_t weight = constrain(WiFi.RSSI(i) + 100, 1, 100);
+    for (uint8_t c = 0; c < SCAN_CHANNEL_COUNT; c++) {
+      if (abs(apChannel - scanChannels[c]) <= 2) load[c] += weight;
+    }
+  }
+  WiFi.scanDelete();
+
+  uint8_t best = 0;
+  for (uint8_t c = 1; c < SCAN_CHANNEL_COUNT; c++) {
+    if (load[c] < load[best]) best = c;
+  }
+  return scanChannels[best];
+}
@@ -0,0 +1,13 @@
+#include <Arduino.h>
+
+/**
+ * Starts scanning for access points in the background, to find the least busy channel
+ */
+void startChannelScan();
+
+/**
+ * Picks the channel with the least access point traffic around, out of the
+ * non-overlapping channels 1, 6 and 11
+ * @return the channel once the scan is over, 0 while still scanning
+ */
+uint8_t leastBusyChannel();
@@ -5,6 +5,14 @@
 
 #define MAX_PLAYERS 5
 #define MAX_BADDIES 5
+// The board is laid out in display pixels, so nodes with different displays
+// can't share a game: the geometry is the low nibble of the version byte.
+#if defined(DISPLAY_SSD1306_128X64)
+#define BOARD_GEOMETRY 1 // 128x64
+#else
+#define BOARD_GEOMETRY 0 // 84x48
+#endif
+#define PROTOCOL_VERSION (3 << 4 | BOARD_GEOMETRY) // bump the high nibble on any payload change, peers with another version are ignored
 
 struct fpoint_t {
   float x;
@@ -23,12 +31,25 @@ struct player_t {
   fpoint_t ball;
 };
 
+// Hello payload, asks the master to enlist us, also used as keepalive and to rejoin our game
+struct payload_e_t {
+  char header = 'E';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session; // SESSION_ANY while looking for a game
+  uint8_t points; // kept by a player rejoining its game, e.g. after deep sleep
+  bool isActive;
+};
+
 // Board setup payload
 struct payload_l_t {
   char header = 'L';
-  upoint_t flag;
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session; // any session, so nodes looking for a game get it too
+  uint16_t gameSession;
+  uint32_t seed; // seed of the level generator for this round
   uint8_t level;
-  upoint_t baddies[MAX_BADDIES];
+  uint8_t flagAttempt;
+  uint8_t baddieAttempts[MAX_BADDIES];
   uint8_t playerCount;
   player_t players[MAX_PLAYERS];
 };
@@ -36,22 +57,69 @@ struct payload_l_t {
 // Position update payload
 struct payload_p_t {
   char header = 'P';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
   fpoint_t point;
 };
 
 // Player lost payload
 struct payload_f_t {
   char header = 'F';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
   uint8_t mac[6];
 };
 
 // Level up payload
 struct payload_u_t {
   char header = 'U';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
   uint8_t level;
-  upoint_t flag;
-  upoint_t baddie;
+  uint8_t flagAttempt; // spots are recomputed from the level generator
+  uint8_t baddieAttempt;
+  uint8_t mac[6];
+};
+
+// Collision claim payload, sent by a client to the master
+struct payload_c_t {
+  char header = 'C';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
+  char kind; // 'U' for flag reached, 'F' for baddie hit
+  uint8_t level;
+  fpoint_t ball;
+};
+
+// Claim rejected payload, sent by the master so the claimant rolls back at once
+struct payload_r_t {
+  char header = 'R';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
+  uint8_t mac[6]; // claimant
+  char kind;
+  uint8_t level; // as claimed
+};
+
+// Player state replicated in the heartbeat
+struct heartbeat_player_t {
   uint8_t mac[6];
+  uint8_t points;
+  bool isActive;
+};
+
+// Master heartbeat payload, carries the state a new master takes over from
+struct payload_h_t {
+  char header = 'H';
+  uint8_t version = PROTOCOL_VERSION;
+  uint16_t session;
+  uint32_t seed;
+  uint8_t level;
+  uint8_t timer;
+  uint8_t flagAttempt;
+  uint8_t baddieAttempts[MAX_BADDIES];
+  uint8_t playerCount;
+  heartbeat_player_t players[MAX_PLAYERS];
 };
 
 #endif
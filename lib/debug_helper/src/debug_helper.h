@@ -1,8 +1,8 @@
 #include <Arduino.h>
 #include "common.h"
+#include "event_log.h"
 
-void printMac(const uint8_t *mac);
-
-void printArray(const uint8_t ary[], const uint8_t len);
-
+/**
+ * Logs every player of the list as a LOG_PLAYER record
+ */
 void debugPlayerList(player_t players[], uint8_t playerCount);
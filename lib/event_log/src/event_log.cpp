@@ -0,0 +1,61 @@
+#include "event_log.h"
+
+#define LOG_HEADER_SIZE 7 // sync, event, length, millis
+
+// Writers are the loop and the ESP-Now callbacks, which run between loop
+// iterations and never in the middle of one, so no locking is needed.
+uint8_t logBuffer[LOG_BUFFER_SIZE];
+uint16_t logHead = 0; // next byte to write
+uint16_t logTail = 0; // next byte to send, equal to logHead when empty
+uint16_t droppedRecords = 0;
+
+uint16_t logFree() {
+  return (logTail + LOG_BUFFER_SIZE - logHead - 1) % LOG_BUFFER_SIZE;
+}
+
+void putLogByte(uint8_t value) {
+  logBuffer[logHead] = value;
+  logHead = (logHead + 1) % LOG_BUFFER_SIZE;
+}
+
+/**
+ * @return false if the record did not fit
+ */
+bool appendRecord(uint8_t event, const uint8_t *data, uint8_t len) {
+  if (len > LOG_MAX_DATA || logFree() < LOG_HEADER_SIZE + len + 1) return false;
+  putLogByte(LOG_SYNC);
+  putLogByte(event);
+  putLogByte(len);
+  uint8_t checksum = event + len;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t value = now >> (8*i);
+    putLogByte(value);
+    checksum += value;
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    putLogByte(data[i]);
+    checksum += data[i];
+  }
+  putLogByte(checksum);
+  return true;
+}
+
+void logEvent(uint8_t event, const uint8_t *data, uint8_t len) {
+  if (!appendRecord(event, data, len)) droppedRecords++;
+}
+
+void drainLog() {
+  while (logTail != logHead) {
+    uint16_t size = LOG_HEADER_SIZE + logBuffer[(logTail + 2) % LOG_BUFFER_SIZE] + 1;
+    if (Serial.availableForWrite() < size) break;
+    // the record may wrap around the end of the buffer
+    uint16_t first = LOG_BUFFER_SIZE - logTail < size ? LOG_BUFFER_SIZE - logTail : size;
+    Serial.write(logBuffer + logTail, first);
+    if (first < size) Serial.write(logBuffer, size - first);
+    logTail = (logTail + size) % LOG_BUFFER_SIZE;
+  }
+  if (droppedRecords > 0 && appendRecord(LOG_DROPPED, (const uint8_t *)&droppedRecords, sizeof(droppedRecords))) {
+    droppedRecords = 0;
+  }
+}
@@ -0,0 +1,123 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+
+// Binary event log: records are queued in RAM and written to Serial later by
+// drainLog(), so logging costs a few copies wherever it happens, callbacks
+// included. tools/log_decoder.py turns the stream back into text. The level is
+// set for the whole build with -D LOG_LEVEL=n, see platformio.ini.
+//
+// Record: LOG_SYNC event length millis(4) data[length] checksum, the checksum
+// being the 8-bit sum of everything after the sync byte.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_NONE // compiled out, arguments are not even evaluated
+#endif
+
+#define LOG_BUFFER_SIZE 512 // bytes queued at most, records beyond are dropped and counted
+#define LOG_MAX_DATA 16 // bytes of data per record
+#define LOG_SYNC 0xA5
+#define LOG_BAUD 115200
+
+// Events and their data, keep tools/log_decoder.py in sync
+#define LOG_DROPPED 0 // uint16 records lost to a full buffer
+#define LOG_RESUMED 1
+#define LOG_ESPNOW_FAILED 2
+#define LOG_DELIVERY_FAILED 3 // uint8 status
+#define LOG_REPLACING_MASTER 4
+#define LOG_NEW_MASTER 5 // mac
+#define LOG_FOLLOWING_MASTER 6 // mac
+#define LOG_MASTER_SILENT 7 // uint32 ms
+#define LOG_PLAYER_REGISTERING 8 // mac
+#define LOG_PLAYERS_FULL 9 // mac
+#define LOG_PLAYER_ADDED 10 // uint8 index
+#define LOG_PLAYER_REMOVED 11 // uint8 index
+#define LOG_PLAYER_TIMED_OUT 12 // mac
+#define LOG_PLAYER 13 // uint8 index, mac, uint8 active, uint8 x, uint8 y
+#define LOG_PLAYER_LOST 14 // int8 index
+#define LOG_PUBLISH_PLAYER_LOST 15 // mac, uint8 x, uint8 y
+#define LOG_CLAIM_ROLLBACK 16 // char kind
+#define LOG_CLAIM_REJECTED 17 // mac
+#define LOG_BOARD_RECEIVED 18 // uint8 player count, int8 my index
+#define LOG_HOSTING 19 // uint8 channel
+#define LOG_NO_GAME_FOUND 20
+#define LOG_FIRST_FRAME 21 // uint32 ms since boot
+#define LOG_REJECTED_PACKETS 22 // uint16 count
+#define LOG_PHYSICS 23 // uint8 sub-steps, uint16 last us, uint16 max us
+#define LOG_TASK 24 // uint8 index, uint16 runs, uint16 avg us, uint16 max us, uint16 missed
+
+struct log_mac_t {
+  uint8_t bytes[6];
+};
+
+/**
+ * @return a MAC address by value, so it is logged as 6 bytes and not as a pointer
+ */
+inline log_mac_t logMac(const uint8_t *mac) {
+  log_mac_t value;
+  memcpy(value.bytes, mac, 6);
+  return value;
+}
+
+/**
+ * Queues a record, or counts it as dropped when the buffer is full
+ * @param event one of the LOG_ events
+ * @param data bytes of the record
+ * @param len number of bytes, at most LOG_MAX_DATA
+ */
+void logEvent(uint8_t event, const uint8_t *data, uint8_t len);
+
+/**
+ * Writes the queued records to Serial, as many whole ones as its transmit
+ * buffer takes without blocking. Meant to be run as the lowest priority task.
+ */
+void drainLog();
+
+template<typename... T> struct log_size {
+  static const uint8_t value = 0;
+};
+
+template<typename T, typename... Rest> struct log_size<T, Rest...> {
+  static const uint8_t value = sizeof(T) + log_size<Rest...>::value;
+};
+
+inline void packLogValues(uint8_t *data) {}
+
+template<typename T, typename... Rest>
+inline void packLogValues(uint8_t *data, const T &value, const Rest &... rest) {
+  memcpy(data, &value, sizeof(T));
+  packLogValues(data + sizeof(T), rest...);
+}
+
+/**
+ * Queues a record made of the raw bytes of the values, in order
+ */
+template<typename... T>
+inline void logValues(uint8_t event, const T &... values) {
+  static_assert(log_size<T...>::value <= LOG_MAX_DATA, "log record too long");
+  uint8_t data[log_size<T...>::value + 1];
+  packLogValues(data, values...);
+  logEvent(event, data, log_size<T...>::value);
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(event, ...) logValues(event, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(event, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(event, ...) logValues(event, ##__VA_ARGS__)
+#else
+#define LOG_INFO(event, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(event, ...) logValues(event, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(event, ...) do {} while (0)
+#endif
+
+#endif
@@ -1,14 +1,33 @@
 #include <U8g2lib.h>
 #include "graphic.h"
+#include "text.h"
+#include "maze.h"
 
+// Text kept between frames, formatted and measured again only when the key changes
+struct cached_text_t {
+  uint32_t key = 0xFFFFFFFF;
+  char text[24];
+  uint8_t width;
+};
+
+#if defined(DISPLAY_SSD1306_128X64)
+U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
+#else
 U8G2_PCD8544_84X48_F_4W_HW_SPI u8g2(U8G2_R0, DISPLAY_CS_PIN, DISPLAY_DC_PIN, DISPLAY_RS_PIN);
+#endif
+cached_text_t statusText, timerText;
 
-void initGraphic(uint8_t *max_x, uint8_t *max_y) {
+void initGraphic() {
   u8g2.begin();
   u8g2.setFont(u8g2_font_baby_tf);
   u8g2.setFontMode(1);
-  *max_x = u8g2.getDisplayWidth();
-  *max_y = u8g2.getDisplayHeight();
+}
+
+void resumeGraphic() {
+  u8g2.beginSimple();
+  u8g2.setPowerSave(0);
+  u8g2.setFont(u8g2_font_baby_tf);
+  u8g2.setFontMode(1);
 }
 
 void drawBoard(
@@ -16,14 +35,15 @@ void drawBoard(
   uint8_t myPlayer,
   player_t players[],
   upoint_t flag,
+  bool flagVisible,
   upoint_t baddies[],
   uint8_t baddiesCount,
+  uint8_t maze,
   uint8_t level,
-  uint8_t timer,
-  uint8_t max_x
+  uint8_t timer
 ) {
-  static char buf[50];
-  u8g2.clearBuffer();
+  // the walls go straight into the frame buffer, replacing the clearing
+  if (!copyMaze(maze, u8g2.getBufferPtr())) u8g2.clearBuffer();
   // draw marbles
   for (uint8_t i = 0; i < playerCount; i++) {
     player_t player = players[i];
@@ -34,8 +54,10 @@ void drawBoard(
       u8g2.drawCircle(players[i].ball.x, players[i].ball.y, BALLSIZE/2);
     }
   }
-  // draw flag
-  u8g2.drawTriangle(flag.x, flag.y-3, flag.x-3, flag.y+2, flag.x+3, flag.y+2);
+  // draw flag, unless hidden while a claim for it is pending
+  if (flagVisible) {
+    u8g2.drawTriangle(flag.x, flag.y-3, flag.x-3, flag.y+2, flag.x+3, flag.y+2);
+  }
   // draw baddies
   for(uint8_t i = 0; i < baddiesCount; i++) {
     u8g2.drawFrame(baddies[i].x-2, baddies[i].y-2, 4, 4);
@@ -43,46 +65,49 @@ void drawBoard(
 
   u8g2.setDrawColor(2);
   // write level and time
-  char status = myPlayer == 0 ? 'M' : 'S';
-  sprintf(buf, "%c Lvl: %d Pts: %d", status, level, players[myPlayer].points);
-
-  u8g2.drawStr(0, 5, buf);
+  uint8_t points = players[myPlayer].points;
+  uint32_t statusKey = (uint32_t)(myPlayer == 0) << 16 | level << 8 | points;
+  if (statusText.key != statusKey) {
+    statusText.key = statusKey;
+    char *end = appendStr(statusText.text, myPlayer == 0 ? "M Lvl: " : "S Lvl: ");
+    end = appendUint(end, level);
+    end = appendStr(end, " Pts: ");
+    appendUint(end, points);
+  }
+  u8g2.drawStr(0, 5, statusText.text);
   if (timer > 0) {
-    itoa(timer/10, buf, 10);
-    uint8_t width = u8g2.getStrWidth(buf);
-    u8g2.drawStr(max_x-width, 5, buf);
+    if (timerText.key != timer/10) {
+      timerText.key = timer/10;
+      appendUint(timerText.text, timer/10);
+      timerText.width = u8g2.getStrWidth(timerText.text);
+    }
+    u8g2.drawStr(DISPLAY_WIDTH-timerText.width, 5, timerText.text);
   }
   u8g2.setDrawColor(1);
 
   u8g2.sendBuffer();
 }
 
-void showPopup(char lines[][40], uint8_t styles[], uint8_t numLines, uint8_t max_x, uint8_t max_y) {
+void showPopup(const char *const lines[], const uint8_t styles[], uint8_t numLines) {
   u8g2.clearBuffer();
-  u8g2.drawRFrame(0, 0, max_x, max_y, 7);
-  Serial.println("Displaying popup");
+  u8g2.drawRFrame(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 7);
   uint8_t totalHeight = numLines * 7;
   for (uint8_t row = 0; row < numLines; row++) {
-    Serial.print(row);
-    Serial.print(" ");
-    Serial.print(lines[row]);
-    Serial.print(" ");
-    Serial.println(styles[row]);
     uint8_t width = u8g2.getStrWidth(lines[row]);
     u8g2_uint_t x, y;
     switch (styles[row] & LINE_ALIGN_MASK)
     {
     case LINE_ALIGN_CENTER:
-      x = (max_x-width)/2;
+      x = (DISPLAY_WIDTH-width)/2;
       break;
     case LINE_ALIGN_RIGHT:
-      x = max_x - 5 - width;
+      x = DISPLAY_WIDTH - 5 - width;
       break;
     default:
       x = 5;
       break;
     }
-    y = (max_y - totalHeight)/2 + (row+1)*7;
+    y = (DISPLAY_HEIGHT - totalHeight)/2 + (row+1)*7;
     if ((styles[row] & COLOR_MASK) == COLOR_INVERT) {
       u8g2.drawBox(x, y-6, width, 6);
       u8g2.setDrawColor(0);
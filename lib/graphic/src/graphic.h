@@ -1,9 +1,19 @@
 #include <Arduino.h>
 #include "common.h"
 
+// Display backend is chosen at build time, see platformio.ini. Board geometry
+// follows from it as constants, so bounds checks fold at compile time.
+#if defined(DISPLAY_SSD1306_128X64)
+// I2C, shares the bus with the accelerometer
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+#else
 #define DISPLAY_CS_PIN D3
 #define DISPLAY_DC_PIN D0
 #define DISPLAY_RS_PIN D4
+#define DISPLAY_WIDTH 84
+#define DISPLAY_HEIGHT 48
+#endif
 
 #define BALLSIZE 4
 
@@ -16,18 +26,25 @@
 #define COLOR_NORMAL 0x00
 #define COLOR_INVERT 0x04
 
-void initGraphic(uint8_t *max_x, uint8_t *max_y);
+void initGraphic();
+
+/**
+ * Takes the display over after deep sleep. It stayed powered, so it is not
+ * cleared: the first frame overwrites it anyway.
+ */
+void resumeGraphic();
 
 void drawBoard(
   uint8_t playerCount,
   uint8_t myPlayer,
   player_t players[],
   upoint_t flag,
+  bool flagVisible,
   upoint_t baddies[],
   uint8_t baddiesCount,
+  uint8_t maze,
   uint8_t points,
-  uint8_t timer,
-  uint8_t max_x
+  uint8_t timer
 );
 
 /**
@@ -35,7 +52,5 @@ void drawBoard(
  * @param lines Lines to show
  * @param styles Text style of each line
  * @param numLines How many lines
- * @param max_x
- * @param max_y
  */
-void showPopup(char lines[][40], uint8_t styles[], uint8_t numLines, uint8_t max_x, uint8_t max_y);
+void showPopup(const char *const lines[], const uint8_t styles[], uint8_t numLines);
@@ -1,13 +1,15 @@
 #include "common.h"
 #include "last_seen.h"
 
+#define LAST_SEEN_SIZE MAX_PLAYERS*2
+
 struct last_seen_t {
   uint8_t mac[6];
   unsigned long timestamp;
 };
 
 uint8_t lastSeenCount = 0;
-last_seen_t lastSeen[MAX_PLAYERS*2]; // warning: this list is not cleaned up
+last_seen_t lastSeen[LAST_SEEN_SIZE]; // not cleaned up, the stalest entry is reused when full
 
 int8_t getLastSeenIndexByMac(const uint8_t mac[6]) {
   for (uint8_t i = 0; i < lastSeenCount; i++) {
@@ -22,11 +24,23 @@ unsigned long getLastSeenByMac(const uint8_t mac[6]) {
   return lastSeen[index].timestamp;
 }
 
+/**
+ * Finds a slot for a new MAC, reusing the one seen longest ago if the list is full
+ * @return index of the slot
+ */
+uint8_t getFreeLastSeenIndex() {
+  if (lastSeenCount < LAST_SEEN_SIZE) return lastSeenCount++;
+  uint8_t oldest = 0;
+  for (uint8_t i = 1; i < lastSeenCount; i++) {
+    if (lastSeen[i].timestamp < lastSeen[oldest].timestamp) oldest = i;
+  }
+  return oldest;
+}
+
 void updateLastSeenByMac(const uint8_t mac[6]) {
   int8_t i = getLastSeenIndexByMac(mac);
   if (i < 0) {
-    i = lastSeenCount;
-    lastSeenCount++;
+    i = getFreeLastSeenIndex();
     memcpy(lastSeen[i].mac, mac, 6);
   }
   lastSeen[i].timestamp = millis();
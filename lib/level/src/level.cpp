@@ -0,0 +1,46 @@
+#include "level.h"
+#include "graphic.h"
+#include "maze.h"
+
+uint32_t mixBits(uint32_t value) {
+  value ^= value >> 16;
+  value *= 0x85ebca6b;
+  value ^= value >> 13;
+  value *= 0xc2b2ae35;
+  value ^= value >> 16;
+  return value;
+}
+
+upoint_t levelPlace(uint32_t seed, uint8_t level, uint8_t object, uint8_t attempt) {
+  uint32_t hash = mixBits(seed ^ mixBits((uint32_t)level | (uint32_t)object << 8 | (uint32_t)attempt << 16));
+  upoint_t point;
+  point.x = (hash & 0xFFFF) % (DISPLAY_WIDTH - 2*BALLSIZE) + BALLSIZE;
+  point.y = (hash >> 16) % (DISPLAY_HEIGHT - 2*BALLSIZE) + BALLSIZE;
+  return point;
+}
+
+uint8_t levelMaze(uint32_t seed) {
+  return mixBits(seed ^ 0x4D415A45) % (mazeCount() + 1); // "MAZE", keeps it apart from levelPlace
+}
+
+uint8_t levelSpawnAttempt(uint32_t seed, uint8_t level, uint8_t object, uint8_t maze, const fpoint_t balls[], uint8_t ballCount, uint8_t minDistance) {
+  uint8_t attempt = 0;
+  for (; attempt < SPAWN_ATTEMPTS; attempt++) {
+    upoint_t point = levelPlace(seed, level, object, attempt);
+    // keep out of the walls, with room for the flag drawing
+    bool valid = !mazeHit(maze, point.x-3, point.y-3, 7, 7);
+    for (uint8_t i = 0; valid && i < ballCount; i++) {
+      if (abs(point.x-balls[i].x) + abs(point.y-balls[i].y) < minDistance) valid = false;
+    }
+    if (valid) break;
+  }
+  return attempt;
+}
+
+bool levelWon(uint8_t level, uint8_t baddieRate) {
+  return level % baddieRate == 0 && level / baddieRate >= MAX_BADDIES;
+}
+
+bool IRAM_ATTR isCollided(const fpoint_t ball, const upoint_t point) {
+  return abs(ball.x-point.x) < 3 && abs(ball.y-point.y) < 3;
+}
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include "common.h"
+
+#define LEVEL_FLAG 0
+#define LEVEL_BADDIE 1
+#define SPAWN_ATTEMPTS 255 // candidates tried before settling for the last one
+
+/**
+ * Scrambles the bits of a 32-bit value (MurmurHash3 finalizer), so
+ * neighbouring inputs give unrelated outputs on any platform
+ */
+uint32_t mixBits(uint32_t value);
+
+/**
+ * Deterministic level generator: the same arguments give the same spot on
+ * every node, so only the seed and attempt numbers need to be sent around
+ * @param seed seed of the round
+ * @param level level the object spawns at
+ * @param object LEVEL_FLAG or LEVEL_BADDIE
+ * @param attempt number of the candidate, increased when a spot is rejected
+ * @return candidate spot, at least BALLSIZE away from the walls
+ */
+upoint_t levelPlace(uint32_t seed, uint8_t level, uint8_t object, uint8_t attempt);
+
+/**
+ * Picks the obstacle layout of a round, the same way on every node
+ * @param seed seed of the round
+ * @return maze number, MAZE_NONE for an open board
+ */
+uint8_t levelMaze(uint32_t seed);
+
+/**
+ * Finds a place for a new flag or baddie, clear of the maze and not super close
+ * to any of the given balls. The other nodes get the same place from the
+ * attempt number alone.
+ * @param seed seed of the round
+ * @param level level the object spawns at
+ * @param object LEVEL_FLAG or LEVEL_BADDIE
+ * @param maze maze of the round
+ * @param balls balls to keep away from
+ * @param ballCount number of balls
+ * @param minDistance least distance (dx+dy) from any ball
+ * @return attempt number of the chosen place
+ */
+uint8_t levelSpawnAttempt(uint32_t seed, uint8_t level, uint8_t object, uint8_t maze, const fpoint_t balls[], uint8_t ballCount, uint8_t minDistance);
+
+/**
+ * @return true if the round is won on reaching this level, when no room is left for another baddie
+ */
+bool levelWon(uint8_t level, uint8_t baddieRate);
+
+/**
+ * Checks if a ball collided with another point
+ * @param ball coordinates of the ball
+ * @param point coordinates of an object to check collision with
+ * @returns true if collided
+ */
+bool isCollided(const fpoint_t ball, const upoint_t point);
@@ -0,0 +1,37 @@
+#include "maze.h"
+#include "maze_data.h"
+
+uint8_t mazeCount() {
+  return sizeof(mazeData) / sizeof(mazeData[0]);
+}
+
+bool IRAM_ATTR mazeHit(uint8_t maze, int16_t x, int16_t y, uint8_t width, uint8_t height) {
+  if (maze == MAZE_NONE || maze > mazeCount()) return false;
+  // the board edges are handled by the physics, outside is free
+  int16_t right = x + width - 1, bottom = y + height - 1;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (right >= DISPLAY_WIDTH) right = DISPLAY_WIDTH - 1;
+  if (bottom >= DISPLAY_HEIGHT) bottom = DISPLAY_HEIGHT - 1;
+  if (x > right || y > bottom) return false;
+
+  const uint32_t *words = mazeData[maze-1];
+  for (int16_t page = y/8; page <= bottom/8; page++) {
+    uint8_t top = y > page*8 ? y - page*8 : 0;
+    uint8_t last = bottom < page*8 + 7 ? bottom - page*8 : 7;
+    uint32_t rows = (uint32_t)(0xFF >> (7 - last + top) << top) * 0x01010101; // same rows in each of the 4 columns
+    for (int16_t word = x/4; word <= right/4; word++) {
+      uint8_t first = x > word*4 ? x - word*4 : 0;
+      uint8_t end = right < word*4 + 3 ? right - word*4 : 3;
+      uint32_t columns = 0xFFFFFFFF >> (8 * (3 - end + first)) << (8 * first);
+      if (pgm_read_dword(&words[page*MAZE_STRIDE/4 + word]) & rows & columns) return true;
+    }
+  }
+  return false;
+}
+
+bool copyMaze(uint8_t maze, uint8_t *buffer) {
+  if (maze == MAZE_NONE || maze > mazeCount()) return false;
+  memcpy_P(buffer, mazeData[maze-1], MAZE_WORDS * 4);
+  return true;
+}
@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include "graphic.h"
+
+// Mazes are kept in the layout of the U8g2 frame buffer: DISPLAY_HEIGHT/8
+// pages, each a byte per column (padded to whole tiles) with the top row in
+// the least significant bit. The layouts are in mazes.txt, see tools/maze_gen.py.
+#define MAZE_NONE 0
+#define MAZE_STRIDE ((DISPLAY_WIDTH+7)/8*8) // bytes per page
+#define MAZE_PAGES ((DISPLAY_HEIGHT+7)/8)
+#define MAZE_WORDS (MAZE_STRIDE*MAZE_PAGES/4)
+
+/**
+ * @return number of mazes available, numbered from 1
+ */
+uint8_t mazeCount();
+
+/**
+ * Tests a rectangle against the walls of a maze, a 32-bit word (4 columns
+ * by 8 rows) at a time, so the cost does not depend on the maze
+ * @param maze maze number, MAZE_NONE for an open board
+ * @param x left edge
+ * @param y top edge
+ * @param width width in pixels
+ * @param height height in pixels
+ * @return true when any pixel of the rectangle is a wall
+ */
+bool mazeHit(uint8_t maze, int16_t x, int16_t y, uint8_t width, uint8_t height);
+
+/**
+ * Copies the walls of a maze over a frame buffer
+ * @param maze maze number
+ * @param buffer U8g2 full frame buffer
+ * @return false for MAZE_NONE, leaving the buffer untouched
+ */
+bool copyMaze(uint8_t maze, uint8_t *buffer);
@@ -46,6 +46,15 @@ void setupMMA()
   mmaSetActiveMode();
 }
 
+void resumeMMA()
+{
+  Wire.begin();
+
+  mmaSetStandbyMode();
+  mmaDisableInterrupt();
+  mmaSetActiveMode();
+}
+
 void getOrientation(float xyz_g[3]) {
   unsigned int data[7];
 
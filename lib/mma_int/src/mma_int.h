@@ -11,4 +11,7 @@ void mmaDisableInterrupt();
 
 void setupMMA();
 
+// Back to measuring after a wake up by motion, the chip kept the rest of its setup
+void resumeMMA();
+
 void getOrientation(float xyz_g[3]);
\ No newline at end of file
@@ -1,12 +1,13 @@
 #include "music.h"
 
-uint16_t tonesFlag[][2] = {{698, 1}, {880, 1}, {1047, 1}, {0, 0}};
-uint16_t tonesLevel[][2] = {{1047, 1}, {988, 1}, {1047, 1}, {988, 1}, {1047, 1}, {0, 0}};
-uint16_t tonesSad[][2] = {{262, 4}, {247, 4}, {233, 4}, {220, 12}, {0, 0}};
-uint16_t tonesEnd[][2] = {{392, 2}, {523, 2}, {659, 2}, {784, 4}, {659, 2}, {784, 8}, {0, 0}};
+// melodies stay in flash, read with pgm_read_word
+const uint16_t tonesFlag[][2] PROGMEM = {{698, 1}, {880, 1}, {1047, 1}, {0, 0}};
+const uint16_t tonesLevel[][2] PROGMEM = {{1047, 1}, {988, 1}, {1047, 1}, {988, 1}, {1047, 1}, {0, 0}};
+const uint16_t tonesSad[][2] PROGMEM = {{262, 4}, {247, 4}, {233, 4}, {220, 12}, {0, 0}};
+const uint16_t tonesEnd[][2] PROGMEM = {{392, 2}, {523, 2}, {659, 2}, {784, 4}, {659, 2}, {784, 8}, {0, 0}};
 
 uint8_t melodyIndex;
-uint16_t (*currentMelody)[2];
+const uint16_t (*currentMelody)[2];
 
 /**
  * plays the melody asynchronously while the user continues playing
@@ -15,8 +16,8 @@ void playSound() {
   if (currentMelody) {
     uint8_t totalCount = 0;
     for (uint8_t i = 0; 1; i++) {
-      uint16_t freq = currentMelody[i][0];
-      uint16_t dur = currentMelody[i][1];
+      uint16_t freq = pgm_read_word(&(currentMelody[i][0]));
+      uint16_t dur = pgm_read_word(&(currentMelody[i][1]));
       if (melodyIndex == totalCount) {
         if (dur == 0) {
           noTone(BUZZER_PIN);
@@ -55,8 +56,10 @@ void melodyEnd(void) {
 }
 
 void playSynchronously(const uint16_t (*melody)[2]) {
-  for (uint8_t i = 0; melody[i][1] > 0; i++) {
-    tone(BUZZER_PIN, melody[i][0], melody[i][1]*300);
-    delay(melody[i][1] * 300 + 50);
+  for (uint8_t i = 0; pgm_read_word(&(melody[i][1])) > 0; i++) {
+    uint16_t freq = pgm_read_word(&(melody[i][0]));
+    uint16_t dur = pgm_read_word(&(melody[i][1]));
+    tone(BUZZER_PIN, freq, dur*300);
+    delay(dur * 300 + 50);
   }
 }
@@ -0,0 +1,41 @@
+#include "packet.h"
+
+const packet_schema_t *packetSchemas = NULL;
+uint8_t packetSchemaCount = 0;
+uint16_t packetSession = SESSION_ANY;
+uint16_t rejectedCount = 0;
+
+void registerPackets(const packet_schema_t schemas[], uint8_t count) {
+  packetSchemas = schemas;
+  packetSchemaCount = count;
+}
+
+void setPacketSession(uint16_t session) {
+  packetSession = session;
+}
+
+bool IRAM_ATTR dispatchPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  if (len < PACKET_HEADER_SIZE) {
+    rejectedCount++;
+    return false;
+  }
+  // drop other games' traffic before anything else
+  uint16_t session = readField<uint16_t>(data, 2);
+  if (session != packetSession && session != SESSION_ANY) {
+    rejectedCount++;
+    return false;
+  }
+  for (uint8_t i = 0; i < packetSchemaCount; i++) {
+    const packet_schema_t *schema = &(packetSchemas[i]);
+    if (schema->header != (char)data[0]) continue;
+    if (schema->version != data[1] || len < schema->size) break;
+    if (schema->handler(mac, data, len)) return true;
+    break;
+  }
+  rejectedCount++;
+  return false;
+}
+
+uint16_t rejectedPacketCount() {
+  return rejectedCount;
+}
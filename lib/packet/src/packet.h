@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include <stddef.h>
+
+#define PACKET_HEADER_SIZE 4
+#define SESSION_ANY 0 // accepted by all sessions, for nodes looking for a game
+
+// returns false when the packet turns out not to belong to our game
+typedef bool (*packet_handler_t)(const uint8_t *mac, const uint8_t *data, uint8_t len);
+
+// Schema of a message type. Each packet starts with the header byte, the
+// version byte and the 16-bit session, followed by its own fields.
+struct packet_schema_t {
+  char header;
+  uint8_t version;
+  uint8_t size; // packets shorter than this are rejected
+  packet_handler_t handler;
+};
+
+/**
+ * Sets the table of known message types
+ * @param schemas one schema per message type, must outlive the dispatcher
+ * @param count number of schemas
+ */
+void registerPackets(const packet_schema_t schemas[], uint8_t count);
+
+/**
+ * Sets the session to accept packets from, packets of other sessions are dropped
+ * @param session our session
+ */
+void setPacketSession(uint16_t session);
+
+/**
+ * Checks a received packet against its schema and passes it to its handler
+ * @param mac MAC address of the sender
+ * @param data raw packet, no alignment assumed
+ * @param len length of the packet
+ * @return false if the packet was rejected, by the dispatcher or its handler
+ */
+bool dispatchPacket(const uint8_t *mac, const uint8_t *data, uint8_t len);
+
+/**
+ * @return number of packets rejected for foreign session, unknown type, wrong version, short length
+ * or by their handler
+ */
+uint16_t rejectedPacketCount();
+
+/**
+ * Reads a field of a packet in place, safe for unaligned buffers
+ * @param data raw packet
+ * @param offset offset of the field
+ * @return value of the field
+ */
+template <typename T>
+T readField(const uint8_t *data, size_t offset) {
+  T value;
+  memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+// reads a field of a packet of the given payload type
+#define PACKET_FIELD(type, data, field) readField<decltype(type::field)>(data, offsetof(type, field))
+// raw pointer to a field, to be copied out with memcpy or read as bytes
+#define PACKET_FIELD_PTR(type, data, field) ((data) + offsetof(type, field))
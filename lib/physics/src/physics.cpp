@@ -0,0 +1,122 @@
+#include "physics.h"
+
+#define BALL_RADIUS (BALLSIZE/2)
+#define CONTACT_DISTANCE (2*BALL_RADIUS)
+
+PHYSICS_STATE physics_stats_t stats = {PHYSICS_SUBSTEPS, 0, 0};
+PHYSICS_STATE float bounceFactor = BOUNCE_FACTOR;
+
+/**
+ * keeps the ball within the board, bouncing off the walls with a diminishing factor
+ */
+void IRAM_ATTR resolveWalls(fpoint_t *ball, fpoint_t *speed) {
+  if (ball->x > DISPLAY_WIDTH-BALLSIZE) {
+    ball->x = DISPLAY_WIDTH-BALLSIZE;
+    if (speed->x > 0) speed->x = bounceFactor * speed->x;
+  } else if (ball->x < BALLSIZE) {
+    ball->x = BALLSIZE;
+    if (speed->x < 0) speed->x = bounceFactor * speed->x;
+  }
+  if (ball->y > DISPLAY_HEIGHT-BALLSIZE) {
+    ball->y = DISPLAY_HEIGHT-BALLSIZE;
+    if (speed->y > 0) speed->y = bounceFactor * speed->y;
+  } else if (ball->y < BALLSIZE) {
+    ball->y = BALLSIZE;
+    if (speed->y < 0) speed->y = bounceFactor * speed->y;
+  }
+}
+
+/**
+ * pushes the ball out of another one and bounces it off along the contact normal
+ */
+void IRAM_ATTR resolveBall(fpoint_t *ball, fpoint_t *speed, const fpoint_t other) {
+  float dx = ball->x - other.x;
+  float dy = ball->y - other.y;
+  if (abs(dx) >= CONTACT_DISTANCE || abs(dy) >= CONTACT_DISTANCE) return; // cheap rejection first
+  float distSquared = dx*dx + dy*dy;
+  if (distSquared >= CONTACT_DISTANCE*CONTACT_DISTANCE) return;
+  float dist = sqrtf(distSquared);
+  float nx = 1.0, ny = 0.0; // exactly on top of each other, pick any direction
+  if (dist > 0) {
+    nx = dx / dist;
+    ny = dy / dist;
+  }
+  ball->x = other.x + nx * CONTACT_DISTANCE;
+  ball->y = other.y + ny * CONTACT_DISTANCE;
+  float normalSpeed = speed->x * nx + speed->y * ny;
+  if (normalSpeed < 0) { // approaching
+    float change = (bounceFactor - 1) * normalSpeed;
+    speed->x += change * nx;
+    speed->y += change * ny;
+  }
+}
+
+/**
+ * @return whether the ball overlaps a wall of the maze
+ */
+bool IRAM_ATTR inMaze(const fpoint_t ball, uint8_t maze) {
+  return mazeHit(maze, (int16_t)ball.x - BALL_RADIUS, (int16_t)ball.y - BALL_RADIUS, BALLSIZE+1, BALLSIZE+1);
+}
+
+/**
+ * moves the ball back out of a maze wall it entered during the sub-step,
+ * undoing and bouncing only the axis that led into it when possible
+ * @param previous position at the start of the sub-step
+ */
+void IRAM_ATTR resolveMaze(fpoint_t *ball, fpoint_t *speed, const fpoint_t previous, uint8_t maze) {
+  if (!inMaze(*ball, maze)) return;
+  if (inMaze(previous, maze)) return; // already stuck, e.g. the maze changed under us: let it drift out
+  fpoint_t probe = *ball;
+  probe.y = previous.y;
+  if (!inMaze(probe, maze)) {
+    ball->y = previous.y;
+    speed->y = bounceFactor * speed->y;
+    return;
+  }
+  probe = *ball;
+  probe.x = previous.x;
+  if (!inMaze(probe, maze)) {
+    ball->x = previous.x;
+    speed->x = bounceFactor * speed->x;
+    return;
+  }
+  *ball = previous;
+  speed->x = bounceFactor * speed->x;
+  speed->y = bounceFactor * speed->y;
+}
+
+void IRAM_ATTR stepPhysics(fpoint_t *ball, fpoint_t *speed, const fpoint_t acceleration, const fpoint_t others[], uint8_t otherCount, uint8_t maze) {
+  unsigned long start = micros();
+  uint8_t substeps = stats.substeps;
+  float dt = 1.0 / substeps;
+  for (uint8_t step = 0; step < substeps; step++) {
+    fpoint_t previous = *ball;
+    ball->x += speed->x * dt;
+    ball->y += speed->y * dt;
+    speed->x += acceleration.x * dt;
+    speed->y += acceleration.y * dt;
+    for (uint8_t i = 0; i < otherCount; i++) {
+      resolveBall(ball, speed, others[i]);
+    }
+    resolveWalls(ball, speed);
+    resolveMaze(ball, speed, previous, maze);
+  }
+
+  // keep within the budget: drop a sub-step when over it, add one back when there is room
+  uint16_t elapsed = micros() - start;
+  stats.lastMicros = elapsed;
+  if (elapsed > stats.maxMicros) stats.maxMicros = elapsed;
+  if (elapsed > PHYSICS_BUDGET_US) {
+    if (stats.substeps > 1) stats.substeps--;
+  } else if (stats.substeps < PHYSICS_SUBSTEPS && (uint32_t)elapsed * (substeps+1) / substeps < PHYSICS_BUDGET_US) {
+    stats.substeps++;
+  }
+}
+
+void setBounceFactor(float factor) {
+  bounceFactor = factor;
+}
+
+const physics_stats_t *physicsStats() {
+  return &stats;
+}
@@ -0,0 +1,44 @@
+#include <Arduino.h>
+#include "common.h"
+#include "graphic.h"
+#include "maze.h"
+
+#ifndef PHYSICS_SUBSTEPS
+#define PHYSICS_SUBSTEPS 4 // integration sub-steps per frame, at most
+#endif
+#ifndef PHYSICS_BUDGET_US
+#define PHYSICS_BUDGET_US 1000 // CPU time per frame, sub-steps are dropped to stay within
+#endif
+#define BOUNCE_FACTOR -0.5 // the walls and other balls absorb 50% of the speed when hit
+#ifndef PHYSICS_STATE
+#define PHYSICS_STATE // storage of the physics state, thread_local when simulating matches in parallel
+#endif
+
+struct physics_stats_t {
+  uint8_t substeps; // sub-steps used for the next frame
+  uint16_t lastMicros; // time the last frame took
+  uint16_t maxMicros; // worst frame so far
+};
+
+/**
+ * Advances our ball by one frame, resolving contacts with the walls, the maze
+ * and the other balls. Only our ball responds, the other nodes handle their own.
+ * @param ball position of our ball
+ * @param speed speed of our ball, in pixels per frame
+ * @param acceleration change of speed over the frame
+ * @param others positions of the other balls on the board
+ * @param otherCount number of other balls
+ * @param maze walls of the level, MAZE_NONE for an open board
+ */
+void stepPhysics(fpoint_t *ball, fpoint_t *speed, const fpoint_t acceleration, const fpoint_t others[], uint8_t otherCount, uint8_t maze);
+
+/**
+ * Overrides BOUNCE_FACTOR, for tuning
+ * @param factor share of the speed kept, reversed, when hitting a wall or a ball
+ */
+void setBounceFactor(float factor);
+
+/**
+ * @return sub-step count and timing of the physics
+ */
+const physics_stats_t *physicsStats();
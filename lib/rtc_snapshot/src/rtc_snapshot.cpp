@@ -0,0 +1,30 @@
+#include "rtc_snapshot.h"
+
+#define SNAPSHOT_OFFSET 0 // in 4-byte blocks of the RTC user memory
+#define SNAPSHOT_VERSION 3 // bump when snapshot_t changes, so old snapshots are rejected
+
+uint32_t snapshotCrc(const snapshot_t *snapshot) {
+  // CRC-32 of everything following the crc field, seeded with the version
+  const uint8_t *data = (const uint8_t *)snapshot + sizeof(snapshot->crc);
+  uint32_t crc = ~(uint32_t)SNAPSHOT_VERSION;
+  for (size_t i = 0; i < sizeof(snapshot_t) - sizeof(snapshot->crc); i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+void saveSnapshot(snapshot_t *snapshot) {
+  snapshot->crc = snapshotCrc(snapshot);
+  ESP.rtcUserMemoryWrite(SNAPSHOT_OFFSET, (uint32_t *)snapshot, sizeof(snapshot_t));
+}
+
+bool loadSnapshot(snapshot_t *snapshot) {
+  if (!ESP.rtcUserMemoryRead(SNAPSHOT_OFFSET, (uint32_t *)snapshot, sizeof(snapshot_t))) return false;
+  if (snapshot->crc != snapshotCrc(snapshot)) return false;
+  uint32_t invalid = ~snapshot->crc;
+  ESP.rtcUserMemoryWrite(SNAPSHOT_OFFSET, &invalid, sizeof(invalid));
+  return true;
+}
@@ -0,0 +1,31 @@
+#include <Arduino.h>
+#include "common.h"
+
+// Game and session state kept in RTC user memory during deep sleep
+struct snapshot_t {
+  uint32_t crc;
+  uint32_t seed; // seed for the random generator after wake up
+  uint16_t session;
+  uint8_t channel;
+  uint8_t masterMac[6];
+  uint8_t level;
+  uint8_t timer;
+  uint32_t levelSeed;
+  uint8_t flagAttempt;
+  uint8_t baddieAttempts[MAX_BADDIES];
+  uint8_t playerCount;
+  player_t players[MAX_PLAYERS];
+};
+
+/**
+ * Stores the snapshot in RTC memory, which survives deep sleep
+ * @param snapshot snapshot to store, its checksum is filled in
+ */
+void saveSnapshot(snapshot_t *snapshot);
+
+/**
+ * Reads the snapshot from RTC memory and invalidates it, so it's only restored once
+ * @param snapshot where to read the snapshot to
+ * @return true if a valid snapshot was found
+ */
+bool loadSnapshot(snapshot_t *snapshot);
@@ -0,0 +1,65 @@
+#include "scheduler.h"
+#include "event_log.h"
+
+task_t tasks[MAX_TASKS];
+uint8_t taskCount = 0;
+
+void addTask(const char *name, task_function_t run, uint16_t period, uint8_t priority) {
+  if (taskCount >= MAX_TASKS) return;
+  // keep the list ordered by priority, so it can be run front to back
+  uint8_t i = taskCount;
+  for (; i > 0 && tasks[i-1].priority > priority; i--) {
+    tasks[i] = tasks[i-1];
+  }
+  task_t *task = &(tasks[i]);
+  memset(task, 0, sizeof(task_t));
+  task->name = name;
+  task->run = run;
+  task->period = period;
+  task->priority = priority;
+  task->nextRun = millis();
+  taskCount++;
+}
+
+void runTask(task_t *task, unsigned long now) {
+  unsigned long start = micros();
+  task->run();
+  uint16_t elapsed = micros() - start;
+  task->totalMicros += elapsed;
+  if (elapsed > task->maxMicros) task->maxMicros = elapsed;
+  task->runs++;
+
+  task->nextRun += task->period;
+  if ((long)(now - task->nextRun) >= 0) {
+    // a whole period late: skip the missed runs instead of running them back to back
+    task->missed += (now - task->nextRun) / task->period + 1;
+    task->nextRun = now + task->period;
+  }
+}
+
+void runScheduler() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    unsigned long now = millis();
+    if ((long)(now - tasks[i].nextRun) >= 0) runTask(&(tasks[i]), now);
+  }
+
+  long wait = 0x7FFF;
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < taskCount; i++) {
+    long untilDue = (long)(tasks[i].nextRun - now);
+    if (untilDue < wait) wait = untilDue;
+  }
+  delay(wait > 0 ? wait : 0); // lets the WiFi stack run too
+}
+
+void reportTasks() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    task_t *task = &(tasks[i]);
+    LOG_DEBUG(LOG_TASK, i, task->runs, (uint16_t)(task->runs > 0 ? task->totalMicros / task->runs : 0),
+      task->maxMicros, task->missed);
+    task->totalMicros = 0;
+    task->maxMicros = 0;
+    task->runs = 0;
+    task->missed = 0;
+  }
+}
@@ -0,0 +1,36 @@
+#include <Arduino.h>
+
+#define MAX_TASKS 8
+
+typedef void (*task_function_t)();
+
+struct task_t {
+  const char *name;
+  task_function_t run;
+  uint16_t period; // ms between runs
+  uint8_t priority; // of the tasks due at the same time, the lowest number runs first
+  unsigned long nextRun;
+  uint32_t totalMicros; // runtime since the last report
+  uint16_t maxMicros;
+  uint16_t runs;
+  uint16_t missed; // runs skipped because the task was late by a whole period or more
+};
+
+/**
+ * Registers a task to be run periodically
+ * @param name name of the task, the report identifies it by its place in the priority order
+ * @param run function to run
+ * @param period ms between runs
+ * @param priority of the tasks due at the same time, the lowest number runs first
+ */
+void addTask(const char *name, task_function_t run, uint16_t period, uint8_t priority);
+
+/**
+ * Runs the tasks that are due, in order of priority, then sleeps until the next one is due
+ */
+void runScheduler();
+
+/**
+ * Logs runtime and missed deadlines per task, one LOG_TASK record each, and starts measuring anew
+ */
+void reportTasks();
@@ -0,0 +1,50 @@
+#include "send_rate.h"
+
+#define SEND_MIN_MOVE 0.5 // don't send while the ball moved less than this since the last update
+#define SEND_SHARP_CHANGE 1.0 // send at once when speed changed more than this (e.g. a bounce)
+#define SEND_INTERVAL_MIN 50 // ms between updates with a single peer and no losses
+#define SEND_INTERVAL_PER_PEER 25 // ms added for each additional peer
+#define SEND_INTERVAL_PER_LOSS 25 // ms added for each point of the loss score
+#define SEND_INTERVAL_MAX 250 // never wait longer than this while moving
+#define SEND_KEEPALIVE 500 // send at least this often, even when resting, so we aren't cleaned up
+#define MAX_LOSS_SCORE 8
+#define MAX_COUNTED_GAP 4 // heartbeat intervals, a longer silence is a change of master rather than congestion
+
+fpoint_t lastSentBall, lastSentSpeed;
+unsigned long lastSentTime = 0;
+unsigned long lastHeartbeatTime = 0;
+uint8_t lossScore = 0; // goes up on each heartbeat missed, down on each one heard on time
+
+void IRAM_ATTR recordHeartbeat(uint16_t interval) {
+  unsigned long now = millis();
+  unsigned long gap = (now - lastHeartbeatTime + interval/2) / interval; // in intervals, rounded
+  if (lastHeartbeatTime != 0 && gap <= MAX_COUNTED_GAP) {
+    if (gap > 1) {
+      lossScore += gap - 1;
+      if (lossScore > MAX_LOSS_SCORE) lossScore = MAX_LOSS_SCORE;
+    } else if (lossScore > 0) {
+      lossScore--;
+    }
+  }
+  lastHeartbeatTime = now;
+}
+
+uint16_t sendInterval(uint8_t peerCount) {
+  uint16_t interval = SEND_INTERVAL_MIN + lossScore * SEND_INTERVAL_PER_LOSS;
+  if (peerCount > 1) interval += (peerCount - 1) * SEND_INTERVAL_PER_PEER;
+  return interval < SEND_INTERVAL_MAX ? interval : SEND_INTERVAL_MAX;
+}
+
+bool isPositionDue(const fpoint_t ball, const fpoint_t speed, uint8_t peerCount) {
+  unsigned long elapsed = millis() - lastSentTime;
+  if (elapsed >= SEND_KEEPALIVE) return true;
+  if (abs(speed.x - lastSentSpeed.x) + abs(speed.y - lastSentSpeed.y) > SEND_SHARP_CHANGE) return true;
+  if (abs(ball.x - lastSentBall.x) + abs(ball.y - lastSentBall.y) < SEND_MIN_MOVE) return false;
+  return elapsed >= sendInterval(peerCount);
+}
+
+void recordPositionSent(const fpoint_t ball, const fpoint_t speed) {
+  lastSentBall = ball;
+  lastSentSpeed = speed;
+  lastSentTime = millis();
+}
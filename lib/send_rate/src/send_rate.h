@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include "common.h"
+
+/**
+ * Records a heartbeat heard from the master. Broadcasts are never acknowledged,
+ * so heartbeats missing in between are the losses we can observe, and they slow
+ * down position updates. The master hears none and scales by peer count only.
+ * @param interval ms between heartbeats of the master
+ */
+void recordHeartbeat(uint16_t interval);
+
+/**
+ * Decides if our position should be published this frame
+ * @param ball current position of our ball
+ * @param speed current speed of our ball
+ * @param peerCount number of other players sharing the channel
+ * @return true if the position should be sent
+ */
+bool isPositionDue(const fpoint_t ball, const fpoint_t speed, uint8_t peerCount);
+
+/**
+ * Records the position and speed just published
+ */
+void recordPositionSent(const fpoint_t ball, const fpoint_t speed);
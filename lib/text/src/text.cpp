@@ -0,0 +1,27 @@
+#include "text.h"
+
+char *appendStr(char *buf, const char *str) {
+  while (*str) *buf++ = *str++;
+  *buf = '\0';
+  return buf;
+}
+
+char *appendUint(char *buf, uint16_t value) {
+  char digits[5];
+  uint8_t count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (count > 0) *buf++ = digits[--count];
+  *buf = '\0';
+  return buf;
+}
+
+char *appendHex(char *buf, uint8_t value) {
+  static const char hex[] = "0123456789abcdef";
+  *buf++ = hex[value >> 4];
+  *buf++ = hex[value & 0x0f];
+  *buf = '\0';
+  return buf;
+}
@@ -0,0 +1,25 @@
+#include <Arduino.h>
+
+/**
+ * Appends a string
+ * @param buf where to write, gets null-terminated
+ * @param str string to append
+ * @return pointer to the terminating null, to continue appending from
+ */
+char *appendStr(char *buf, const char *str);
+
+/**
+ * Appends a number in decimal
+ * @param buf where to write, gets null-terminated
+ * @param value number to append
+ * @return pointer to the terminating null, to continue appending from
+ */
+char *appendUint(char *buf, uint16_t value);
+
+/**
+ * Appends a byte as two lowercase hex digits
+ * @param buf where to write, gets null-terminated
+ * @param value byte to append
+ * @return pointer to the terminating null, to continue appending from
+ */
+char *appendHex(char *buf, uint8_t value);
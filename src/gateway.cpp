@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+
+#include "common.h"
+#include "packet.h"
+
+// Gateway build: a non-playing observer forwarding the game traffic it hears
+// to a host over Serial. It never sends anything, so players don't see it.
+
+#define GATEWAY_BAUD 921600
+#define HOP_INTERVAL 300 // ms listening on each channel while looking for a game
+#define LOST_TIMEOUT 3000 // look for a game again after 3 seconds of silence
+#define STATUS_INTERVAL 1000 // ms between status frames
+#define QUEUE_SIZE 16 // packets buffered between the receive callback and the loop
+
+// Serial framing: FRAME_SYNC1 FRAME_SYNC2 type length body[length] checksum,
+// the checksum being the 8-bit sum of type, length and body
+#define FRAME_SYNC1 0xA5
+#define FRAME_SYNC2 0x5A
+#define FRAME_PACKET 0x01 // body: time (ms, uint32 LE), sender MAC, channel, raw packet
+#define FRAME_STATUS 0x02 // body: time (ms, uint32 LE), dropped (uint16 LE), session (uint16 LE), channel
+
+#define MAX_PACKET_SIZE (255 - 4 - 6 - 1) // largest packet a frame can carry, game payloads are far smaller
+
+struct queued_packet_t {
+  uint32_t time;
+  uint8_t mac[6];
+  uint8_t channel;
+  uint8_t len;
+  uint8_t data[MAX_PACKET_SIZE];
+};
+
+const uint8_t hopChannels[] = {1, 6, 11};
+uint8_t hopIndex = 0;
+uint8_t channel = hopChannels[0];
+uint16_t session = SESSION_ANY; // game we follow, SESSION_ANY while looking for one
+unsigned long lastHeard = 0;
+unsigned long lastHop = 0;
+unsigned long lastStatus = 0;
+
+queued_packet_t queue[QUEUE_SIZE];
+volatile uint8_t queueHead = 0; // next slot to write, only moved by the callback
+volatile uint8_t queueTail = 0; // next slot to read, only moved by the loop
+volatile uint16_t droppedCount = 0;
+
+void setChannel(uint8_t newChannel) {
+  channel = newChannel;
+  wifi_set_channel(channel);
+}
+
+void onDataReceive(uint8_t *mac, uint8_t *data, uint8_t len) {
+  if (len < PACKET_HEADER_SIZE || len > MAX_PACKET_SIZE) return; // not a game packet, and would overflow the frame length
+  uint16_t packetSession = readField<uint16_t>(data, 2);
+  if (session == SESSION_ANY) {
+    // follow the first game heard, hellos of lone nodes don't count
+    if (packetSession == SESSION_ANY) return;
+    session = packetSession;
+  } else if (packetSession != session && packetSession != SESSION_ANY) {
+    return;
+  }
+  lastHeard = millis();
+
+  uint8_t next = (queueHead + 1) % QUEUE_SIZE;
+  if (next == queueTail) {
+    droppedCount++;
+    return;
+  }
+  queued_packet_t *packet = &(queue[queueHead]);
+  packet->time = lastHeard;
+  memcpy(packet->mac, mac, 6);
+  packet->channel = channel;
+  packet->len = len;
+  memcpy(packet->data, data, len);
+  queueHead = next;
+}
+
+/**
+ * Writes bytes to Serial, adding them to the frame checksum
+ */
+void writeFrameBytes(const uint8_t *bytes, uint8_t len, uint8_t *checksum) {
+  for (uint8_t i = 0; i < len; i++) *checksum += bytes[i];
+  Serial.write(bytes, len);
+}
+
+void writeFrameStart(uint8_t type, uint8_t length, uint8_t *checksum) {
+  Serial.write(FRAME_SYNC1);
+  Serial.write(FRAME_SYNC2);
+  *checksum = 0;
+  writeFrameBytes(&type, 1, checksum);
+  writeFrameBytes(&length, 1, checksum);
+}
+
+void writePacketFrame(const queued_packet_t *packet) {
+  uint8_t checksum;
+  writeFrameStart(FRAME_PACKET, 4 + 6 + 1 + packet->len, &checksum);
+  writeFrameBytes((const uint8_t *)&(packet->time), 4, &checksum);
+  writeFrameBytes(packet->mac, 6, &checksum);
+  writeFrameBytes(&(packet->channel), 1, &checksum);
+  writeFrameBytes(packet->data, packet->len, &checksum);
+  Serial.write(checksum);
+}
+
+void writeStatusFrame() {
+  uint8_t checksum;
+  uint32_t time = millis();
+  uint16_t dropped = droppedCount;
+  writeFrameStart(FRAME_STATUS, 4 + 2 + 2 + 1, &checksum);
+  writeFrameBytes((const uint8_t *)&time, 4, &checksum);
+  writeFrameBytes((const uint8_t *)&dropped, 2, &checksum);
+  writeFrameBytes((const uint8_t *)&session, 2, &checksum);
+  writeFrameBytes(&channel, 1, &checksum);
+  Serial.write(checksum);
+}
+
+/**
+ * Hops channels until a game is heard, and starts over when it goes silent
+ */
+void followGame() {
+  unsigned long now = millis();
+  if (session != SESSION_ANY) {
+    if (now - lastHeard < LOST_TIMEOUT) return;
+    session = SESSION_ANY; // game ended or moved
+  }
+  if (now - lastHop < HOP_INTERVAL) return;
+  lastHop = now;
+  hopIndex = (hopIndex + 1) % sizeof(hopChannels);
+  setChannel(hopChannels[hopIndex]);
+}
+
+void setup(void) {
+  Serial.begin(GATEWAY_BAUD);
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  if (esp_now_init() != 0) return;
+  esp_now_set_self_role(ESP_NOW_ROLE_SLAVE);
+  setChannel(channel);
+  esp_now_register_recv_cb(onDataReceive);
+}
+
+void loop(void) {
+  while (queueTail != queueHead) {
+    writePacketFrame(&(queue[queueTail]));
+    queueTail = (queueTail + 1) % QUEUE_SIZE;
+  }
+  if (millis() - lastStatus >= STATUS_INTERVAL) {
+    lastStatus = millis();
+    writeStatusFrame();
+  }
+  followGame();
+  yield();
+}
@@ -8,32 +8,81 @@
 #include "music.h"
 #include "last_seen.h"
 #include "debug_helper.h"
+#include "event_log.h"
+#include "rtc_snapshot.h"
+#include "text.h"
+#include "packet.h"
+#include "send_rate.h"
+#include "channel_scan.h"
+#include "physics.h"
+#include "level.h"
+#include "maze.h"
+#include "scheduler.h"
 
-#define DEBUG true
 // depending on how your sensor and display are oriented, should be 1 or -1:
 #define MMA_X_ORIENTATION 1
 #define MMA_Y_ORIENTATION 1
 
 #define ACC_FACTOR 0.5 // how strong "gravity" is
-#define BOUNCE_FACTOR -0.5 // the walls absorb 50% of the speed when hit
-#define DELAY 50 // ms between calculations and updates
-#define MAX_TIMER 10*1000/DELAY
+#define FRAME_INTERVAL 50 // ms between calculations and updates
+#define RENDER_INTERVAL 50 // ms between redraws
+#define NETWORK_INTERVAL 20 // ms between checks of discovery, heartbeat and master liveness
+#define SOUND_INTERVAL 50 // ms per melody time unit
+#define TIMER_INTERVAL 100 // ms per round timer tick
+#define MAX_TIMER 10*1000/TIMER_INTERVAL
+#define POPUP_DURATION 5000 // ms a popup stays on
 #define MIN_DISTANCE 30 // avoid spawning flags too close to the ball
 #define BADDIE_RATE 5 // spawn new baddie on every nth gathered flag
-#define KEEPALIVE_EACH 20 // publish keepalive record each 20 cycles
+#define KEEPALIVE_INTERVAL 1000 // publish keepalive record each second
+#define REPORT_INTERVAL 10000 // print task statistics every 10 seconds when debugging
+#define LOG_INTERVAL 20 // ms between writing queued log records to Serial
 #define CLEANUP_TIMEOUT 2000 // clean up players not publishing in the past 2 seconds
+#define DISCOVERY_INTERVAL 50 // ms before repeating the first hello, doubled after each one
+#define DISCOVERY_ATTEMPTS 6 // give up looking for an ongoing game after 6 hellos, 2 per channel
+#define HEARTBEAT_INTERVAL 200 // master publishes its state every 200 ms
+#define MASTER_TIMEOUT 600 // fail over when master hasn't been heard from in 600 ms
+#define CLAIM_TIMEOUT 300 // roll back a collision claim not confirmed by master within 300 ms
+#define CLAIM_TOLERANCE 10 // max distance between claimed and last known position of a ball
+#define SLEEP_TIMEOUT 30000 // deep sleep when our ball hasn't moved for 30 seconds, shake to wake
+#define SLEEP_MIN_MOVE 2 // pixels the ball has to move to count as played
+
+struct received_claim_t {
+  uint8_t mac[6];
+  payload_c_t payload;
+};
 
 player_t players[MAX_PLAYERS];
-uint8_t max_x, max_y, level, timer = MAX_TIMER;
+uint8_t level, timer = MAX_TIMER;
 fpoint_t balls[MAX_PLAYERS], speed = {0.0, 0.0};
-upoint_t flag, baddies[MAX_BADDIES];
+upoint_t flag, baddies[MAX_BADDIES]; // generated from the seed, level and attempt numbers below
+uint8_t maze = MAZE_NONE; // generated from the seed
+uint32_t levelSeed;
+uint8_t flagAttempt, baddieAttempts[MAX_BADDIES];
 uint8_t playerCount = 1;
 uint8_t myPlayer = 0;
 uint8_t myMac[6];
 uint8_t masterMac[6];
-uint16_t popupDisplayTimer = 0;
+unsigned long popupUntil = 0;
 bool shouldPublishGameState = false;
-unsigned long counter = 0;
+bool shouldRejoin = false; // the master's heartbeat doesn't list us, hello it to be taken back
+char pendingClaim = 0; // kind of own collision claim waiting for master, 0 if none
+unsigned long claimTimestamp = 0;
+upoint_t claimedPoint; // flag or baddie of the last own claim
+char rolledBackClaim = 0; // kind of the last claim rolled back, not claimed again until the ball leaves it
+uint8_t rolledBackLevel;
+fpoint_t idleBall; // where our ball was last seen moving
+unsigned long idleSince = 0;
+received_claim_t receivedClaims[MAX_PLAYERS]; // (master only) claims to validate in the next frame
+uint8_t receivedClaimCount = 0;
+unsigned long lastHeartbeat = 0;
+bool discovering = true; // looking for an ongoing game while already playing alone
+uint8_t discoveryAttempts = 0;
+unsigned long nextHello = 0;
+uint16_t session; // random id of our game, traffic of other games is dropped
+uint8_t channel = 1;
+bool choosingChannel = false; // scanning for the least busy channel to host our game on
+const uint8_t discoveryChannels[] = {1, 6, 11};
+uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 bool isMultiplayer() {
   return playerCount > 1;
@@ -67,45 +116,39 @@ player_t *activePlayer() {
 }
 
 /**
- * Finds a random place on the board, not super close to any of the active players
- * @return coordinates of a random point
+ * Finds a place on the board for a new flag or baddie, away from the active players
+ * @param forLevel level the object spawns at
+ * @param object LEVEL_FLAG or LEVEL_BADDIE
+ * @return attempt number of the chosen place
  */
-upoint_t randomPlace() {
-  upoint_t point;
-  bool valid = true;
-  do {
-    valid = true;
-    point.x = random(max_x - 2*BALLSIZE) + BALLSIZE;
-    point.y = random(max_y - 2*BALLSIZE) + BALLSIZE;
-    // ensure not spawning too close to any player
-    for (int i = 0; i < playerCount; i++) {
-      if (!players[i].isActive) break; // ignore positions of inactive players
-      if (abs(point.x-players[i].ball.x) + abs(point.y-players[i].ball.y) < MIN_DISTANCE) {
-        valid = false;
-        break;
-      }
-    }
-  } while(!valid);
-  return point;
+uint8_t spawnAttempt(const uint8_t forLevel, const uint8_t object) {
+  fpoint_t balls[MAX_PLAYERS];
+  uint8_t ballCount = 0;
+  for (uint8_t i = 0; i < playerCount; i++) {
+    if (players[i].isActive) balls[ballCount++] = players[i].ball; // ignore positions of inactive players
+  }
+  // the maze comes from the seed, which may be newer than the board
+  return levelSpawnAttempt(levelSeed, forLevel, object, levelMaze(levelSeed), balls, ballCount, MIN_DISTANCE);
 }
 
 /**
- * puts the ball of a player to the center of the board
- * @param player player whose ball position to reset
+ * Recomputes the flag and baddies of the current level from the seed and attempt numbers
  */
-void initBall(player_t *player) {
-  player->ball.x = max_x / 2;
-  player->ball.y = max_y / 2;
+void generateBoard() {
+  maze = levelMaze(levelSeed);
+  flag = levelPlace(levelSeed, level, LEVEL_FLAG, flagAttempt);
+  for (uint8_t i = 0; i < baddiesCount() && i < MAX_BADDIES; i++) {
+    baddies[i] = levelPlace(levelSeed, (i+1)*BADDIE_RATE, LEVEL_BADDIE, baddieAttempts[i]);
+  }
 }
 
 /**
- * Checks if a ball collided with another point
- * @param ball coordinates of the ball
- * @param point coordinates of an object to check collision with
- * @returns true if collided
+ * puts the ball of a player to the center of the board
+ * @param player player whose ball position to reset
  */
-bool isCollided(const fpoint_t ball, const upoint_t point) {
-  return abs(ball.x-point.x) < 3 && abs(ball.y-point.y) < 3;
+void initBall(player_t *player) {
+  player->ball.x = DISPLAY_WIDTH / 2;
+  player->ball.y = DISPLAY_HEIGHT / 2;
 }
 
 /**
@@ -121,23 +164,19 @@ int8_t getPlayerIndexByMac(const uint8_t mac[6]) {
 }
 
 /**
- * replace master with a remaining player with the lowest MAC
+ * replace master with a remaining player with the lowest MAC. As all nodes
+ * share the same player list, they all elect the same one.
  */
 void replaceMaster() {
-#ifdef DEBUG
-  Serial.println("Replacing master");
-#endif
+  LOG_INFO(LOG_REPLACING_MASTER);
   memcpy(masterMac, players[0].mac, 6);
   for (uint8_t i = 1; i < playerCount; i++) {
-    if (memcmp(players[i].mac, masterMac, 6) == -1) {
-      memcpy(masterMac, players[0].mac, 6);
+    if (memcmp(players[i].mac, masterMac, 6) < 0) {
+      memcpy(masterMac, players[i].mac, 6);
     }
   }
-#ifdef DEBUG
-  Serial.print("New master: ");
-  printMac(masterMac);
-  Serial.println();
-#endif
+  lastHeartbeat = 0; // if we took over, announce it right away
+  LOG_INFO(LOG_NEW_MASTER, logMac(masterMac));
 }
 
 /**
@@ -145,24 +184,14 @@ void replaceMaster() {
  */
 void removePlayer(int8_t playerIndex) {
   bool masterGone = sameMacs(players[playerIndex].mac, masterMac);
-#ifdef DEBUG
-  Serial.print("Removing player with index ");
-  Serial.println(playerIndex);
-#endif
+  LOG_INFO(LOG_PLAYER_REMOVED, (uint8_t)playerIndex);
   for (int i = playerIndex; i < playerCount-1; i++) {
     players[i] = players[i+1];
   }
   playerCount--;
   myPlayer = getPlayerIndexByMac(myMac);
-#ifdef DEBUG
   debugPlayerList(players, playerCount);
-#endif
-  if (masterGone) {
-#ifdef DEBUG
-    Serial.println("Master gone, replacing...");
-#endif
-    replaceMaster();
-  }
+  if (masterGone) replaceMaster();
 }
 
 /**
@@ -180,26 +209,51 @@ void resetAllPlayers(const bool state) {
 }
 
 void publishHello() {
-  char header = 'E';
-  esp_now_send(NULL, (uint8_t *) &header, sizeof(header));
+  payload_e_t payload;
+  payload.session = discovering ? SESSION_ANY : session;
+  payload.points = players[myPlayer].points;
+  payload.isActive = players[myPlayer].isActive;
+  esp_now_send(NULL, (uint8_t *) &payload, sizeof(payload));
 }
 
 void publishGameState() {
   if (!isMultiplayer()) return;
   payload_l_t payload;
-  payload.flag = flag;
+  payload.session = SESSION_ANY;
+  payload.gameSession = session;
+  payload.seed = levelSeed;
   payload.level = level;
-  memcpy(&(payload.baddies), baddies, baddiesCount() * sizeof(upoint_t));
+  payload.flagAttempt = flagAttempt;
+  memcpy(&(payload.baddieAttempts), baddieAttempts, sizeof(baddieAttempts));
   payload.playerCount = playerCount;
   memcpy(&(payload.players), players, playerCount * sizeof(player_t));
   esp_now_send(NULL, (uint8_t *) &payload, sizeof(payload_l_t));
 }
 
-void publishLevelUp(const uint8_t mac[6], const uint8_t newLevel, const upoint_t newFlag, const upoint_t baddie) {
+void publishHeartbeat() {
+  if (!isMultiplayer()) return;
+  payload_h_t payload;
+  payload.session = session;
+  payload.seed = levelSeed;
+  payload.level = level;
+  payload.timer = timer;
+  payload.flagAttempt = flagAttempt;
+  memcpy(&(payload.baddieAttempts), baddieAttempts, sizeof(baddieAttempts));
+  payload.playerCount = playerCount;
+  for (uint8_t i = 0; i < playerCount; i++) {
+    memcpy(payload.players[i].mac, players[i].mac, 6);
+    payload.players[i].points = players[i].points;
+    payload.players[i].isActive = players[i].isActive;
+  }
+  esp_now_send(NULL, (uint8_t *)&payload, sizeof(payload));
+}
+
+void publishLevelUp(const uint8_t mac[6], const uint8_t newLevel, const uint8_t newFlagAttempt, const uint8_t newBaddieAttempt) {
   if (!isMultiplayer()) return;
   payload_u_t payload;
-  payload.flag = newFlag;
-  payload.baddie = baddie;
+  payload.session = session;
+  payload.flagAttempt = newFlagAttempt;
+  payload.baddieAttempt = newBaddieAttempt;
   payload.level = newLevel;
   memcpy(payload.mac, mac, 6);
 
@@ -209,57 +263,81 @@ void publishLevelUp(const uint8_t mac[6], const uint8_t newLevel, const upoint_t
 void publishPosition(const player_t player) {
   if (!isMultiplayer()) return;
   payload_p_t payload;
+  payload.session = session;
   payload.point = player.ball;
   esp_now_send(NULL, (uint8_t *) &payload, sizeof(payload_p_t));
+  recordPositionSent(player.ball, speed);
+}
+
+void publishClaim(const char kind) {
+  payload_c_t payload;
+  payload.session = session;
+  payload.kind = kind;
+  payload.level = level;
+  payload.ball = players[myPlayer].ball;
+  esp_now_send(NULL, (uint8_t *)&payload, sizeof(payload));
+}
+
+void publishClaimRejected(const uint8_t mac[6], const payload_c_t *claim) {
+  payload_r_t payload;
+  payload.session = session;
+  memcpy(payload.mac, mac, 6);
+  payload.kind = claim->kind;
+  payload.level = claim->level;
+  esp_now_send(NULL, (uint8_t *)&payload, sizeof(payload));
 }
 
 void publishPlayerLost(const player_t *player) {
   if (!isMultiplayer()) return;
-#ifdef DEBUG
-  Serial.println("Publishing player lost:");
-  printMac(player->mac);
-  Serial.print(" ball at ");
-  Serial.print(player->ball.x);
-  Serial.print(", ");
-  Serial.println(player->ball.y);
-#endif
+  LOG_INFO(LOG_PUBLISH_PLAYER_LOST, logMac(player->mac), (uint8_t)player->ball.x, (uint8_t)player->ball.y);
   payload_f_t payload;
+  payload.session = session;
   memcpy(payload.mac, player->mac, 6);
   esp_now_send(NULL, (uint8_t *)&payload, sizeof(payload));
 }
 
 /**
- * comparator for sorting
- * @param left left player
- * @param right right player
- * @return -1 if left < right, 1 if left > right, 0 if left == right
+ * Orders players by points, highest first, without moving the player records
+ * @param order filled with indices into the player list
  */
-int comparePlayers(const void *left, const void *right) {
-  player_t *pLeft = (player_t *)left;
-  player_t *pRight = (player_t *)right;
-  return pRight->points - pLeft->points;
+void sortPlayersByPoints(uint8_t order[]) {
+  for (uint8_t i = 0; i < playerCount; i++) {
+    uint8_t j = i;
+    for (; j > 0 && players[order[j-1]].points < players[i].points; j--) {
+      order[j] = order[j-1];
+    }
+    order[j] = i;
+  }
 }
 
 void displayTopList() {
-  player_t playersCopy[MAX_PLAYERS];
-  char list[6][40] = {"Top players:"};
-  memcpy(playersCopy, players, MAX_PLAYERS*sizeof(player_t));
-  qsort(playersCopy, playerCount, sizeof(player_t), comparePlayers);
+  uint8_t order[MAX_PLAYERS];
+  char list[MAX_PLAYERS][12];
+  const char *lines[MAX_PLAYERS+1] = {"Top players:"};
   uint8_t styles[MAX_PLAYERS+1] = {LINE_ALIGN_CENTER};
+  sortPlayersByPoints(order);
   for (uint8_t i = 0; i < playerCount; i++) {
-    styles[i+1] = LINE_ALIGN_LEFT | (myPlayer == i ? COLOR_INVERT : COLOR_NORMAL);
-    sprintf(list[i+1], "%d %02x%02x: %d", i+1, playersCopy[i].mac[4], playersCopy[i].mac[5], playersCopy[i].points);
+    const player_t *player = &(players[order[i]]);
+    styles[i+1] = LINE_ALIGN_LEFT | (myPlayer == order[i] ? COLOR_INVERT : COLOR_NORMAL);
+    char *end = appendUint(list[i], i+1);
+    end = appendStr(end, " ");
+    end = appendHex(end, player->mac[4]);
+    end = appendHex(end, player->mac[5]);
+    end = appendStr(end, ": ");
+    appendUint(end, player->points);
+    lines[i+1] = list[i];
   }
-  showPopup(list, styles, playerCount+1, max_x, max_y);
-  popupDisplayTimer = 5000/DELAY; // 5 seconds
+  showPopup(lines, styles, playerCount+1);
+  popupUntil = millis() + POPUP_DURATION;
 }
 
 void displayGameOver() {
-  char text[2][40] = {"GAME OVER", ""};
-  sprintf(text[1], "score: %d", players[myPlayer].points);
-  uint8_t styles[] = {LINE_ALIGN_CENTER, LINE_ALIGN_CENTER};
-  showPopup(text, styles, 2, max_x, max_y);
-  popupDisplayTimer = 5000/DELAY; // 5 seconds
+  char score[12];
+  appendUint(appendStr(score, "score: "), players[myPlayer].points);
+  const char *lines[] = {"GAME OVER", score};
+  const uint8_t styles[] = {LINE_ALIGN_CENTER, LINE_ALIGN_CENTER};
+  showPopup(lines, styles, 2);
+  popupUntil = millis() + POPUP_DURATION;
 }
 
 void displayEndScreen(bool happyEnd) {
@@ -274,15 +352,14 @@ void displayEndScreen(bool happyEnd) {
 
 void playerLostHandler(const uint8_t mac[6]) {
   int8_t playerIndex = getPlayerIndexByMac(mac);
-#ifdef DEBUG
-  Serial.print("Player lost: ");
-  Serial.println(playerIndex);
-#endif
-  if (playerIndex < 0) return;
+  LOG_INFO(LOG_PLAYER_LOST, playerIndex);
+  if (playerIndex < 0 || !players[playerIndex].isActive) return;
   // handle game end
   players[playerIndex].isActive = false;
   if (myPlayer == playerIndex) {
-    melodySad();
+    // sad melody was already played when the hit was claimed
+    if (pendingClaim != 'F') melodySad();
+    pendingClaim = 0;
     displayGameOver();
   }
   uint8_t playersLeft = activeCount();
@@ -295,10 +372,13 @@ void playerLostHandler(const uint8_t mac[6]) {
   }
 }
 
-void levelUpHandler(const uint8_t mac[6], const uint8_t newLevel, const upoint_t newFlag, const upoint_t newBaddie) {
+void levelUpHandler(const uint8_t mac[6], const uint8_t newLevel, const uint8_t newFlagAttempt, const uint8_t newBaddieAttempt) {
   level = newLevel;
   int8_t playerIndex = getPlayerIndexByMac(mac);
-  if (myPlayer == playerIndex) {
+  // flag was taken, by us or someone else, so any claim for it is settled
+  bool claimed = pendingClaim == 'U';
+  if (claimed) pendingClaim = 0;
+  if (myPlayer == playerIndex && !claimed) {
     if (level % BADDIE_RATE == 0) {
       melodyLevel();
     } else {
@@ -308,24 +388,28 @@ void levelUpHandler(const uint8_t mac[6], const uint8_t newLevel, const upoint_t
   if (playerIndex >= 0) {
     players[playerIndex].points++;
   }
-  flag = newFlag;
-  if (level % BADDIE_RATE == 0) {
-    uint8_t baddieIndex = level / BADDIE_RATE;
-    if (baddieIndex >= MAX_BADDIES) {
-      displayEndScreen(true);
-      resetAllPlayers(false);
-    } else {
-      baddies[baddieIndex-1] = newBaddie;
-    }
+  flagAttempt = newFlagAttempt;
+  if (levelWon(level, BADDIE_RATE)) {
+    displayEndScreen(true);
+    resetAllPlayers(false);
+  } else if (level % BADDIE_RATE == 0) {
+    baddieAttempts[level/BADDIE_RATE - 1] = newBaddieAttempt;
   }
+  generateBoard();
 }
 
 void restartGame() {
   resetAllPlayers(true);
   level = 0;
   timer = activeCount() == 1 ? MAX_TIMER : 0;
-  flag = randomPlace();
+  // clients only fill in the time until the master's board arrives
+  if (isMaster()) levelSeed = random(0x7FFFFFFF);
+  flagAttempt = spawnAttempt(level, LEVEL_FLAG);
+  generateBoard();
   speed = {0.0, 0.0};
+  pendingClaim = 0;
+  rolledBackClaim = 0;
+  idleSince = millis();
   if (isMaster()) publishGameState();
 }
 
@@ -346,18 +430,131 @@ void playerLost(const player_t *player) {
 void levelUp(const uint8_t mac[6]) {
   timer = MAX_TIMER;
   level++;
-  upoint_t newBaddie = {0, 0};
-  upoint_t newFlag = randomPlace();
+  uint8_t newBaddieAttempt = 0;
+  uint8_t newFlagAttempt = spawnAttempt(level, LEVEL_FLAG);
   if (level % BADDIE_RATE == 0) {
     // spawn new baddie
-    newBaddie = randomPlace();
+    newBaddieAttempt = spawnAttempt(level, LEVEL_BADDIE);
+  }
+  publishLevelUp(mac, level, newFlagAttempt, newBaddieAttempt);
+  levelUpHandler(mac, level, newFlagAttempt, newBaddieAttempt);
+}
+
+/**
+ * (client only) report a locally detected collision to the master and give
+ * provisional feedback until the master confirms it or the claim times out
+ * @param kind 'U' for flag reached, 'F' for baddie hit
+ * @param point flag or baddie hit
+ */
+void claimCollision(const char kind, const upoint_t point) {
+  pendingClaim = kind;
+  claimedPoint = point;
+  claimTimestamp = millis();
+  if (kind == 'U') {
+    // predict the melody for the level the master is about to announce
+    if ((level+1) % BADDIE_RATE == 0) {
+      melodyLevel();
+    } else {
+      melodyFlag();
+    }
+  } else {
+    melodySad();
+    speed = {0.0, 0.0}; // hold the ball until the hit is confirmed
   }
-  publishLevelUp(mac, level, newFlag, newBaddie);
-  levelUpHandler(mac, level, newFlag, newBaddie);
+  // master validates the claim against our last position, make sure it's current
+  publishPosition(players[myPlayer]);
+  publishClaim(kind);
+}
+
+/**
+ * (client only) drop the pending claim, the ball is free to move again
+ */
+void rollBackClaim() {
+  LOG_INFO(LOG_CLAIM_ROLLBACK, pendingClaim);
+  rolledBackClaim = pendingClaim;
+  rolledBackLevel = level;
+  pendingClaim = 0;
+}
+
+/**
+ * (client only) roll back provisional feedback if master didn't answer the claim in time
+ */
+void checkClaimTimeout() {
+  if (!pendingClaim) return;
+  if (millis() - claimTimestamp < CLAIM_TIMEOUT) return;
+  rollBackClaim();
+}
+
+/**
+ * (client only) whether the ball is still on the flag or baddie of a rolled back claim,
+ * claiming it again would only get rejected again
+ */
+bool isRolledBack(const upoint_t point) {
+  return rolledBackClaim && point.x == claimedPoint.x && point.y == claimedPoint.y;
+}
+
+/**
+ * (client only) check collisions of own ball only, claiming them from the master
+ */
+void checkOwnCollision() {
+  if (pendingClaim) return;
+  player_t *player = &(players[myPlayer]);
+  if (!(player->isActive)) return;
+  if (rolledBackClaim && (level != rolledBackLevel || !isCollided(player->ball, claimedPoint))) {
+    rolledBackClaim = 0; // left it, or the board has changed
+  }
+  for(int baddieIndex = 0; baddieIndex < baddiesCount(); baddieIndex++) {
+    if (isCollided(player->ball, baddies[baddieIndex]) && !isRolledBack(baddies[baddieIndex])) {
+      return claimCollision('F', baddies[baddieIndex]);
+    }
+  }
+  if (isCollided(player->ball, flag) && !isRolledBack(flag)) {
+    claimCollision('U', flag);
+  }
+}
+
+/**
+ * (master only) checks a claim against the current board and the last known
+ * position of the claiming player
+ * @param player claiming player
+ * @param claim claim received
+ * @return true if the claim should be confirmed
+ */
+bool isClaimValid(const player_t *player, const payload_c_t *claim) {
+  if (claim->level != level) return false; // stale, board has changed since
+  if (abs(claim->ball.x-player->ball.x) + abs(claim->ball.y-player->ball.y) > CLAIM_TOLERANCE) return false;
+  if (claim->kind == 'U') return isCollided(claim->ball, flag);
+  for(int baddieIndex = 0; baddieIndex < baddiesCount(); baddieIndex++) {
+    if (isCollided(claim->ball, baddies[baddieIndex])) return true;
+  }
+  return false;
+}
+
+/**
+ * (master only) confirm valid claims received since the last frame, reject the rest
+ */
+void processClaims() {
+  for (uint8_t i = 0; i < receivedClaimCount; i++) {
+    received_claim_t *claim = &(receivedClaims[i]);
+    int8_t playerIndex = getPlayerIndexByMac(claim->mac);
+    player_t *player = playerIndex >= 0 ? &(players[playerIndex]) : NULL;
+    if (player == NULL || !(player->isActive) || !isClaimValid(player, &(claim->payload))) {
+      LOG_INFO(LOG_CLAIM_REJECTED, logMac(claim->mac));
+      publishClaimRejected(claim->mac, &(claim->payload));
+      continue;
+    }
+    if (claim->payload.kind == 'U') {
+      levelUp(player->mac);
+    } else {
+      playerLost(player);
+    }
+  }
+  receivedClaimCount = 0;
 }
 
 void checkCollision() {
-  if (!isMaster()) return; // check only on master
+  if (!isMaster()) return checkOwnCollision();
+  processClaims();
   for (int playerIndex = 0; playerIndex < playerCount; playerIndex++) {
     player_t *player = &(players[playerIndex]);
     if (!(player->isActive)) continue;
@@ -373,160 +570,359 @@ void checkCollision() {
 }
 
 /**
- * gets the orientation from the accelerometer and updates the speed and position
+ * gets the orientation from the accelerometer and updates the speed and position,
+ * bouncing off the walls and the other balls
  */
 void updateMovement() {
-  players[myPlayer].ball.x += speed.x;
-  players[myPlayer].ball.y += speed.y;
   float xyz_g[3];
   getOrientation(xyz_g);
+  fpoint_t acceleration;
+  acceleration.x = MMA_X_ORIENTATION * ACC_FACTOR * xyz_g[0];
+  acceleration.y = MMA_Y_ORIENTATION * ACC_FACTOR * xyz_g[1];
+
+  fpoint_t others[MAX_PLAYERS];
+  uint8_t otherCount = 0;
+  for (uint8_t i = 0; i < playerCount; i++) {
+    if (i == myPlayer || !players[i].isActive) continue;
+    others[otherCount++] = players[i].ball;
+  }
+  stepPhysics(&(players[myPlayer].ball), &speed, acceleration, others, otherCount, maze);
+}
 
-  speed.x += MMA_X_ORIENTATION * ACC_FACTOR * xyz_g[0];
-  speed.y += MMA_Y_ORIENTATION * ACC_FACTOR * xyz_g[1];
+/**
+ * Keeps the game and session state in RTC memory, to be resumed on wake up
+ */
+void saveGameSnapshot() {
+  snapshot_t snapshot;
+  snapshot.seed = random(0x7FFFFFFF);
+  snapshot.session = session;
+  snapshot.channel = channel;
+  memcpy(snapshot.masterMac, masterMac, 6);
+  snapshot.level = level;
+  snapshot.timer = timer;
+  snapshot.levelSeed = levelSeed;
+  snapshot.flagAttempt = flagAttempt;
+  memcpy(&(snapshot.baddieAttempts), baddieAttempts, sizeof(baddieAttempts));
+  snapshot.playerCount = playerCount;
+  memcpy(&(snapshot.players), players, playerCount * sizeof(player_t));
+  saveSnapshot(&snapshot);
 }
 
 /**
- * bounces off walls with a diminishing factor
+ * Resumes the game saved before going to sleep
+ * @return true if there was a valid snapshot including this node
  */
-void bounce() {
-  fpoint_t ball = players[myPlayer].ball;
-  if ((speed.x > 0 && ball.x >= max_x-BALLSIZE) || (speed.x < 0 && ball.x <= BALLSIZE)) {
-    speed.x = BOUNCE_FACTOR * speed.x;
+bool restoreGameSnapshot() {
+  snapshot_t snapshot;
+  if (!loadSnapshot(&snapshot)) return false;
+  if (snapshot.playerCount < 1 || snapshot.playerCount > MAX_PLAYERS) return false;
+  playerCount = snapshot.playerCount;
+  memcpy(&players, &(snapshot.players), playerCount * sizeof(player_t));
+  int8_t playerIndex = getPlayerIndexByMac(myMac);
+  if (playerIndex < 0) {
+    playerCount = 1;
+    return false;
   }
-  if ((speed.y > 0 && ball.y >= max_y-BALLSIZE) || (speed.y < 0 && ball.y <= BALLSIZE)) {
-    speed.y = BOUNCE_FACTOR * speed.y;
+  myPlayer = playerIndex;
+  randomSeed(snapshot.seed);
+  session = snapshot.session;
+  channel = snapshot.channel;
+  memcpy(masterMac, snapshot.masterMac, 6);
+  level = snapshot.level;
+  timer = snapshot.timer;
+  levelSeed = snapshot.levelSeed;
+  flagAttempt = snapshot.flagAttempt;
+  memcpy(baddieAttempts, &(snapshot.baddieAttempts), sizeof(baddieAttempts));
+  generateBoard();
+  if (isMaster() && isMultiplayer()) {
+    // the others failed over while we slept, to the lowest MAC but ours: follow it, the board corrects us
+    int8_t successor = -1;
+    for (uint8_t i = 0; i < playerCount; i++) {
+      if (i == myPlayer) continue;
+      if (successor < 0 || memcmp(players[i].mac, players[successor].mac, 6) < 0) successor = i;
+    }
+    memcpy(masterMac, players[successor].mac, 6);
   }
+  // peers count as just seen, so the ones gone meanwhile get cleaned up as usual
+  for (uint8_t i = 0; i < playerCount; i++) {
+    if (i != myPlayer) updateLastSeenByMac(players[i].mac);
+  }
+  return true;
 }
 
 void goToSleep() {
-  char text[][40] = {"SLEEPING...", "shake to wake"};
-  uint8_t styles[] = {LINE_ALIGN_CENTER, LINE_ALIGN_CENTER};
-  showPopup(text, styles, 2, max_x, max_y);
+  const char *lines[] = {"SLEEPING...", "shake to wake"};
+  const uint8_t styles[] = {LINE_ALIGN_CENTER, LINE_ALIGN_CENTER};
+  showPopup(lines, styles, 2);
+  saveGameSnapshot();
   mmaSetupMotionDetection();
-  ESP.deepSleep(0);
+  ESP.deepSleep(0, WAKE_NO_RFCAL); // the RF calibration is kept in RTC memory too
 }
 
 /**
- * Adds a player with the given mac to the player list
+ * Go to sleep once our ball has been resting for SLEEP_TIMEOUT
+ */
+void checkIdle() {
+  const fpoint_t ball = players[myPlayer].ball;
+  if (abs(ball.x - idleBall.x) + abs(ball.y - idleBall.y) >= SLEEP_MIN_MOVE) {
+    idleBall = ball;
+    idleSince = millis();
+  } else if (millis() - idleSince >= SLEEP_TIMEOUT) {
+    goToSleep();
+  }
+}
+
+/**
+ * Adds a player with the given mac to the player list, or starts a listed one over
  * @param mac MAC address of the new player
+ * @param points points to start with, kept by a player rejoining our game
+ * @param isActive whether it is in play, newcomers wait for the next round
  */
-void registerNewPlayer(const uint8_t mac[6]) {
-#ifdef DEBUG
-  Serial.println("Registering new player");
-#endif
+void registerNewPlayer(const uint8_t mac[6], uint8_t points, bool isActive) {
+  LOG_DEBUG(LOG_PLAYER_REGISTERING, logMac(mac));
   int8_t playerIndex = getPlayerIndexByMac(mac);
   if (playerIndex == -1) { // new player
     if (playerCount >= MAX_PLAYERS) {
-#ifdef DEBUG
-      Serial.println("Max number of players reached, not adding another!");
-#endif
+      LOG_ERROR(LOG_PLAYERS_FULL, logMac(mac));
       return;
     }
-#ifdef DEBUG
-    Serial.println("New player not found, adding it");
-#endif
     playerIndex = playerCount;
+    LOG_INFO(LOG_PLAYER_ADDED, (uint8_t)playerIndex);
     player_t *newPlayer = &(players[playerIndex]);
     memcpy(newPlayer->mac, mac, 6);
     playerCount++;
     shouldPublishGameState = true; // publishing must be done outside the handler
   }
 
-  players[playerIndex].isActive = false;
-  players[playerIndex].points = 0;
+  players[playerIndex].isActive = isActive;
+  players[playerIndex].points = points;
   initBall(&(players[playerIndex]));
   if (activeCount() > 1) timer = 0;
-#ifdef DEBUG
   debugPlayerList(players, playerCount);
-#endif
+}
+
+bool handleHelloPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  // two nodes discovering at once: only the lower MAC answers, so they don't enlist each other
+  if (isMaster() && (!discovering || memcmp(mac, myMac, 6) > 0)) {
+    if (PACKET_FIELD(payload_e_t, data, session) == SESSION_ANY) {
+      registerNewPlayer(mac, 0, false);
+      // the sender is still looking for a game, so it missed our board: send it again
+      if (getPlayerIndexByMac(mac) >= 0) shouldPublishGameState = true;
+    } else if (getPlayerIndexByMac(mac) < 0) {
+      // one of ours we had cleaned up, back from deep sleep or cut off by a false failover: it keeps its score
+      registerNewPlayer(mac, PACKET_FIELD(payload_e_t, data, points), PACKET_FIELD(payload_e_t, data, isActive));
+    }
+  }
+  return getPlayerIndexByMac(mac) >= 0; // a node looking for a game is none of ours until enlisted
+}
+
+/**
+ * Checks if a board payload lists the given player
+ * @param data raw board payload
+ * @param mac MAC of the player to look for
+ */
+bool boardListsMac(const uint8_t *data, const uint8_t mac[6]) {
+  uint8_t count = PACKET_FIELD(payload_l_t, data, playerCount);
+  const uint8_t *listed = PACKET_FIELD_PTR(payload_l_t, data, players);
+  for (uint8_t i = 0; i < count; i++) {
+    if (sameMacs(listed + i*sizeof(player_t) + offsetof(player_t, mac), mac)) return true;
+  }
+  return false;
 }
 
 /**
  * new position received, update appropriate player
- * @param mac MAC address of the player sending the position
- * @param point their current position
  */
-void updatePlayerPosition(const uint8_t *mac, const fpoint_t point) {
+bool handlePositionPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
   int8_t playerIndex = getPlayerIndexByMac(mac);
   if (playerIndex >= 0) {
-    players[playerIndex].ball = point;
-    updateLastSeenByMac(mac);
+    players[playerIndex].ball = PACKET_FIELD(payload_p_t, data, point);
   }
+  return true;
 }
 
-void handleBoardPayload(const uint8_t *mac, const payload_l_t *payload) {
-#ifdef DEBUG
-  Serial.println("Board payload received");
-#endif
+bool handleLevelUpPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  levelUpHandler(
+    PACKET_FIELD_PTR(payload_u_t, data, mac),
+    PACKET_FIELD(payload_u_t, data, level),
+    PACKET_FIELD(payload_u_t, data, flagAttempt),
+    PACKET_FIELD(payload_u_t, data, baddieAttempt)
+  );
+  return true;
+}
+
+bool handlePlayerLostPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  playerLostHandler(PACKET_FIELD_PTR(payload_f_t, data, mac));
+  return true;
+}
+
+/**
+ * Heartbeat received, take over the replicated state so any node is ready to become master
+ */
+bool handleHeartbeatPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  if (!sameMacs(mac, masterMac)) {
+    // two nodes think they are master: the one with the lower MAC wins,
+    // unless ours is gone already, in which case we follow the sender
+    bool masterAlive = isMaster() || millis() - getLastSeenByMac(masterMac) < MASTER_TIMEOUT;
+    if (memcmp(mac, masterMac, 6) > 0 && masterAlive) return true;
+    LOG_INFO(LOG_FOLLOWING_MASTER, logMac(mac));
+    memcpy(masterMac, mac, 6);
+  }
+  recordHeartbeat(HEARTBEAT_INTERVAL);
+  uint8_t newLevel = PACKET_FIELD(payload_h_t, data, level);
+  if (newLevel != level && pendingClaim == 'U') pendingClaim = 0;
+  level = newLevel;
+  timer = PACKET_FIELD(payload_h_t, data, timer);
+  levelSeed = PACKET_FIELD(payload_h_t, data, seed);
+  flagAttempt = PACKET_FIELD(payload_h_t, data, flagAttempt);
+  memcpy(&baddieAttempts, PACKET_FIELD_PTR(payload_h_t, data, baddieAttempts), sizeof(baddieAttempts));
+  generateBoard();
+  uint8_t count = PACKET_FIELD(payload_h_t, data, playerCount);
+  // byte-only records, safe to read in place
+  const heartbeat_player_t *replicated = (const heartbeat_player_t *)PACKET_FIELD_PTR(payload_h_t, data, players);
+  // the master's list is the one that counts: after a false failover ours may lack it, or it may lack us
+  player_t synced[MAX_PLAYERS];
+  uint8_t syncedCount = 0;
+  bool listed = false;
+  for (uint8_t i = 0; i < count && i < MAX_PLAYERS; i++) {
+    player_t *player = &(synced[syncedCount++]);
+    memcpy(player->mac, replicated[i].mac, 6);
+    player->points = replicated[i].points;
+    player->isActive = replicated[i].isActive;
+    int8_t playerIndex = getPlayerIndexByMac(replicated[i].mac);
+    if (playerIndex >= 0) {
+      player->ball = players[playerIndex].ball;
+    } else {
+      initBall(player); // until its position arrives
+    }
+    if (sameMacs(player->mac, myMac)) listed = true;
+  }
+  if (!listed) {
+    shouldRejoin = true; // publishing must be done outside the handler
+    if (syncedCount >= MAX_PLAYERS) return true; // no room for us, keep our list until the master makes some
+    synced[syncedCount++] = players[myPlayer];
+  }
+  memcpy(&players, synced, syncedCount * sizeof(player_t));
+  playerCount = syncedCount;
+  myPlayer = getPlayerIndexByMac(myMac);
+  return true;
+}
+
+bool handleBoardPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  uint8_t count = PACKET_FIELD(payload_l_t, data, playerCount);
+  if (count < 1 || count > MAX_PLAYERS) return false;
+  uint16_t gameSession = PACKET_FIELD(payload_l_t, data, gameSession);
+  if (gameSession != session) {
+    // another game: join it only while looking for one, and once it enlisted us
+    if (!discovering || !boardListsMac(data, myMac)) return false;
+    session = gameSession;
+    setPacketSession(session);
+  }
   memcpy(masterMac, mac, 6);
-  flag = payload->flag;
-  level = payload->level;
-  memcpy(&baddies, &(payload->baddies), baddiesCount() * sizeof(upoint_t));
-  playerCount = payload->playerCount;
-  memcpy(&players, &(payload->players), playerCount * sizeof(player_t));
+  levelSeed = PACKET_FIELD(payload_l_t, data, seed);
+  level = PACKET_FIELD(payload_l_t, data, level);
+  flagAttempt = PACKET_FIELD(payload_l_t, data, flagAttempt);
+  memcpy(&baddieAttempts, PACKET_FIELD_PTR(payload_l_t, data, baddieAttempts), sizeof(baddieAttempts));
+  generateBoard();
+  playerCount = count;
+  memcpy(&players, PACKET_FIELD_PTR(payload_l_t, data, players), playerCount * sizeof(player_t));
   myPlayer = getPlayerIndexByMac(myMac);
+  pendingClaim = 0;
+  discovering = false;
   if (activeCount() > 1) timer = 0;
-#ifdef DEBUG
+  LOG_DEBUG(LOG_BOARD_RECEIVED, playerCount, myPlayer);
   debugPlayerList(players, playerCount);
-  Serial.print("My player index: ");
-  Serial.println(myPlayer);
-#endif
+  return true;
+}
+
+/**
+ * (master only) queue a collision claim, to be validated outside the handler
+ */
+bool handleClaimPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  if (!isMaster() || receivedClaimCount >= MAX_PLAYERS) return true;
+  received_claim_t *claim = &(receivedClaims[receivedClaimCount]);
+  memcpy(claim->mac, mac, 6);
+  memcpy(&(claim->payload), data, sizeof(payload_c_t));
+  receivedClaimCount++;
+  return true;
+}
+
+/**
+ * (client only) the master turned our claim down, no need to wait for the timeout
+ */
+bool handleClaimRejectedPacket(const uint8_t *mac, const uint8_t *data, uint8_t len) {
+  if (!sameMacs(PACKET_FIELD_PTR(payload_r_t, data, mac), myMac)) return true;
+  if (pendingClaim != PACKET_FIELD(payload_r_t, data, kind)) return true;
+  if (level != PACKET_FIELD(payload_r_t, data, level)) return true; // the board has changed since, settled otherwise
+  rollBackClaim();
+  return true;
+}
+
+const packet_schema_t packetSchemas[] = {
+  {'E', PROTOCOL_VERSION, sizeof(payload_e_t), handleHelloPacket}, // enlist new one
+  {'L', PROTOCOL_VERSION, sizeof(payload_l_t), handleBoardPacket}, // player list
+  {'P', PROTOCOL_VERSION, sizeof(payload_p_t), handlePositionPacket}, // player position
+  {'U', PROTOCOL_VERSION, sizeof(payload_u_t), handleLevelUpPacket}, // level up
+  {'F', PROTOCOL_VERSION, sizeof(payload_f_t), handlePlayerLostPacket}, // player lost
+  {'H', PROTOCOL_VERSION, sizeof(payload_h_t), handleHeartbeatPacket}, // master heartbeat
+  {'C', PROTOCOL_VERSION, sizeof(payload_c_t), handleClaimPacket}, // collision claim
+  {'R', PROTOCOL_VERSION, sizeof(payload_r_t), handleClaimRejectedPacket}, // claim rejected
+};
+
+void IRAM_ATTR onDataReceive(uint8_t *mac, uint8_t *payload, uint8_t len) {
+  if (dispatchPacket(mac, payload, len)) updateLastSeenByMac(mac);
+}
+
+void IRAM_ATTR onDataSent(uint8_t *mac, uint8_t sendStatus) {
+  if (sendStatus != 0) LOG_ERROR(LOG_DELIVERY_FAILED, sendStatus);
+}
+
+void setChannel(uint8_t newChannel) {
+  channel = newChannel;
+  wifi_set_channel(channel);
+  esp_now_set_peer_channel(broadcastAddress, channel);
+}
+
+/**
+ * Once the channel scan is over, move our game to the least busy channel
+ */
+void channelTick() {
+  if (!choosingChannel) return;
+  uint8_t newChannel = leastBusyChannel();
+  if (newChannel == 0) return;
+  choosingChannel = false;
+  if (isMultiplayer()) return; // somebody joined on the current one meanwhile
+  LOG_INFO(LOG_HOSTING, newChannel);
+  setChannel(newChannel);
 }
 
-void onDataReceive(uint8_t *mac, uint8_t *payload, uint8_t len) {
-  if (len < 1) return;
-  payload_l_t *payload_l;
-  payload_p_t payload_p;
-  payload_u_t *payload_u;
-  payload_f_t *payload_f;
-
-  switch (payload[0])
-  {
-  // enlist new one
-  case 'E':
-    if (isMaster()) registerNewPlayer(mac);
-    updateLastSeenByMac(mac);
-    break;
-  // player list
-  case 'L':
-    payload_l = (payload_l_t *)payload;
-    handleBoardPayload(mac, payload_l);
-    break;
-  // player position
-  case 'P':
-    memcpy(&payload_p, payload, sizeof(payload_p_t));
-    updatePlayerPosition(mac, payload_p.point);
-    break;
-  // level up
-  case 'U':
-    payload_u = (payload_u_t *)payload;
-    levelUpHandler(payload_u->mac, payload_u->level, payload_u->flag, payload_u->baddie);
-    break;
-  // player lost
-  case 'F':
-    payload_f = (payload_f_t *)payload;
-    playerLostHandler(payload_f->mac);
-    break;
-  }
-}
-
-void onDataSent(uint8_t *mac, uint8_t sendStatus) {
-  if (sendStatus != 0) {
-    Serial.print("Delivery fail, status: ");
-    Serial.println(sendStatus);
-  }
-}
-
-/**
- * Publish hello message and wait for the response from master, if any
- */
-void checkIfOngoingMultiplayer() {
+/**
+ * Publish hello messages with increasing intervals, looking for an ongoing game,
+ * until a master responds with the board or DISCOVERY_ATTEMPTS go unanswered
+ */
+void discoveryTick() {
+  if (!discovering) return;
+  unsigned long now = millis();
+  if ((long)(now - nextHello) < 0) return;
+  if (discoveryAttempts >= DISCOVERY_ATTEMPTS || isMultiplayer()) {
+    LOG_INFO(LOG_NO_GAME_FOUND);
+    discovering = false;
+    if (!isMultiplayer()) {
+      // nobody joined us meanwhile, so we are free to move our game to a quieter channel
+      choosingChannel = true;
+      startChannelScan();
+    }
+    return;
+  }
+  // stay on each channel until the next hello, listening for a master
+  setChannel(discoveryChannels[discoveryAttempts % sizeof(discoveryChannels)]);
   publishHello();
-  delay(1000);
+  nextHello = now + (DISCOVERY_INTERVAL << discoveryAttempts);
+  discoveryAttempts++;
 }
 
 bool isShowingPopup() {
-  return popupDisplayTimer > 0;
+  return (long)(popupUntil - millis()) > 0;
 }
 
 /**
@@ -539,26 +935,41 @@ void playerListCleanup() {
     unsigned long lastSeen = getLastSeenByMac(players[i].mac);
     if (lastSeen == 0) continue;
     if (now - lastSeen < CLEANUP_TIMEOUT) continue;
-#ifdef DEBUG
-    Serial.print("Removing player ");
-    printMac(players[i].mac);
-    Serial.println();
-#endif
+    LOG_INFO(LOG_PLAYER_TIMED_OUT, logMac(players[i].mac));
     removePlayer(i);
-#ifdef DEBUG
-    Serial.print("Players left: ");
-    Serial.println(playerCount);
-#endif
     if (activeCount() == 1 && timer == 0) timer = MAX_TIMER;
   }
 }
 
 /**
- * popups are displayed asynchronously, the timer is decreased on every cycle,
- * when the timer runs out, popup is removed.
+ * (client only) remove the master if it missed its heartbeats for MASTER_TIMEOUT
+ * milliseconds, which elects a new one from the remaining players
  */
-void showPopupTick() {
-  if (popupDisplayTimer > 0) popupDisplayTimer--;
+void checkMasterAlive() {
+  if (isMaster() || !isMultiplayer()) return;
+  unsigned long lastSeen = getLastSeenByMac(masterMac);
+  if (lastSeen == 0) return;
+  unsigned long silence = millis() - lastSeen;
+  if (silence < MASTER_TIMEOUT) return;
+  LOG_INFO(LOG_MASTER_SILENT, (uint32_t)silence);
+  int8_t masterIndex = getPlayerIndexByMac(masterMac);
+  if (masterIndex >= 0) {
+    removePlayer(masterIndex);
+  } else {
+    replaceMaster();
+  }
+  if (activeCount() == 1 && timer == 0) timer = MAX_TIMER;
+}
+
+/**
+ * (master only) publish the game state every HEARTBEAT_INTERVAL milliseconds
+ */
+void heartbeatTick() {
+  if (!isMaster()) return;
+  unsigned long now = millis();
+  if (lastHeartbeat != 0 && now - lastHeartbeat < HEARTBEAT_INTERVAL) return;
+  publishHeartbeat();
+  lastHeartbeat = now;
 }
 
 void setupEspNow() {
@@ -566,78 +977,151 @@ void setupEspNow() {
 
   WiFi.mode(WIFI_STA);
   if (esp_now_init() != 0) {
-    Serial.println("Error initializing ESP-NOW");
+    LOG_ERROR(LOG_ESPNOW_FAILED);
     return;
   }
 
   // we want to both send and receive
   esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
   esp_now_register_send_cb(onDataSent);
+  registerPackets(packetSchemas, sizeof(packetSchemas) / sizeof(packet_schema_t));
   esp_now_register_recv_cb(onDataReceive);
 
-  uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-  esp_now_add_peer(broadcastAddress, ESP_NOW_ROLE_SLAVE, 13, NULL, 0);
+  esp_now_add_peer(broadcastAddress, ESP_NOW_ROLE_SLAVE, channel, NULL, 0);
 }
 
-void setup(void) {
-  randomSeed(analogRead(0));
-#ifdef DEBUG
-  Serial.begin(9600);
-#endif
-  initGraphic(&max_x, &max_y);
-  setupEspNow();
-  setupMMA();
-  memcpy(players[0].mac, myMac, 6);
-  memcpy(masterMac, myMac, 6);
+/**
+ * Per frame game logic: collisions, own movement and restarting the game when over
+ */
+void gameTask() {
+  if (activeCount() > 0) { // game ongoing
+    checkClaimTimeout();
+    checkCollision();
+    if (players[myPlayer].isActive && pendingClaim != 'F') {
+      updateMovement();
+      checkIdle();
+      if (isPositionDue(players[myPlayer].ball, speed, playerCount-1)) {
+        publishPosition(players[myPlayer]);
+      }
+    }
+  } else { // game over
+    if (!isShowingPopup()) restartGame();
+  }
+}
 
-  players[myPlayer].isActive = true;
-  checkIfOngoingMultiplayer();
-  if (isMaster()) {
-    initBall(&(players[myPlayer]));
-    flag = randomPlace();
+/**
+ * popups are displayed asynchronously, the board is only drawn when there is none
+ */
+void renderTask() {
+  if (activeCount() == 0 || isShowingPopup()) return;
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  static bool firstFrame = true;
+  if (firstFrame) {
+    firstFrame = false;
+    LOG_DEBUG(LOG_FIRST_FRAME, (uint32_t)millis());
   }
+#endif
+  drawBoard(playerCount, myPlayer, players, flag, pendingClaim != 'U', baddies, baddiesCount(), maze, level, timer);
 }
 
-void loop(void) {
+void networkTask() {
   if (shouldPublishGameState) {
     publishGameState();
     shouldPublishGameState = false;
   }
-  if (activeCount() > 0) { // game ongoing
-    bounce();
-    checkCollision();
-    if (!isShowingPopup()) {
-      drawBoard(playerCount, myPlayer, players, flag, baddies, baddiesCount(), level, timer, max_x);
-    }
-    if (players[myPlayer].isActive) {
-      updateMovement();
-      publishPosition(players[myPlayer]);
-    }
-    if (counter % KEEPALIVE_EACH == 0) {
-      if (!players[myPlayer].isActive) {
-        // as position is not sent when inactive, send a keepalive instead
-        publishHello();
-      }
-      playerListCleanup();
-    }
-  } else { // game over
-    if (!isShowingPopup()) restartGame();
+  if (shouldRejoin) {
+    publishHello(); // carries our score, the master takes us back with it
+    shouldRejoin = false;
+  }
+  discoveryTick();
+  channelTick();
+  checkMasterAlive();
+  heartbeatTick();
+}
+
+void housekeepingTask() {
+  if (activeCount() == 0) return;
+  if (!players[myPlayer].isActive) {
+    // as position is not sent when inactive, send a keepalive instead
+    publishHello();
   }
+  playerListCleanup();
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  static uint16_t lastRejectedCount = 0;
+  if (rejectedPacketCount() != lastRejectedCount) {
+    lastRejectedCount = rejectedPacketCount();
+    LOG_DEBUG(LOG_REJECTED_PACKETS, lastRejectedCount);
+  }
+  static uint8_t lastSubsteps = 0;
+  const physics_stats_t *physics = physicsStats();
+  if (physics->substeps != lastSubsteps) {
+    lastSubsteps = physics->substeps;
+    LOG_DEBUG(LOG_PHYSICS, physics->substeps, physics->lastMicros, physics->maxMicros);
+  }
+#endif
+}
 
-  showPopupTick();
-  playSound();
-  delay(DELAY);
-  counter++;
+void roundTimerTask() {
   if (timer > 0) {
     timer--;
   } else {
     if (isMaster() && activeCount() == 1) { // last player dies
       playerLost(activePlayer());
     }
-    // if (level == 0) {
-    //   goToSleep();
-    // } else {
-    //   playerLost(&(players[myPlayer]));
-    // }
   }
 }
+
+void setupTasks() {
+  addTask("game", gameTask, FRAME_INTERVAL, 0);
+  addTask("network", networkTask, NETWORK_INTERVAL, 1);
+  addTask("render", renderTask, RENDER_INTERVAL, 2);
+  addTask("sound", playSound, SOUND_INTERVAL, 3);
+  addTask("timer", roundTimerTask, TIMER_INTERVAL, 4);
+  addTask("housekeeping", housekeepingTask, KEEPALIVE_INTERVAL, 5);
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  addTask("report", reportTasks, REPORT_INTERVAL, 6);
+#endif
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  addTask("log", drainLog, LOG_INTERVAL, 7); // last, gets what is left of the frame
+#endif
+}
+
+void setup(void) {
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  Serial.begin(LOG_BAUD);
+#endif
+  setupEspNow();
+  bool resumed = ESP.getResetInfoPtr()->reason == REASON_DEEP_SLEEP_AWAKE && restoreGameSnapshot();
+  if (resumed) {
+    LOG_INFO(LOG_RESUMED);
+    // display and accelerometer stayed powered, and we rejoin our game where we left it instead of looking for one
+    resumeGraphic();
+    resumeMMA();
+    discovering = false;
+    setChannel(channel);
+  } else {
+    initGraphic();
+    setupMMA();
+    randomSeed(analogRead(0));
+    session = random(1, 0x10000);
+    memcpy(players[0].mac, myMac, 6);
+    memcpy(masterMac, myMac, 6);
+
+    players[myPlayer].isActive = true;
+    // start playing alone right away, the board is replaced if a master responds
+    initBall(&(players[myPlayer]));
+    levelSeed = random(0x7FFFFFFF);
+    flagAttempt = spawnAttempt(level, LEVEL_FLAG);
+    generateBoard();
+  }
+  setPacketSession(session);
+  // the master has cleaned us up meanwhile, the hello carries our score back
+  if (resumed) publishHello();
+  idleSince = millis();
+  discoveryTick();
+  setupTasks();
+}
+
+void loop(void) {
+  runScheduler();
+}
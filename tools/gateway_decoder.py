@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+"""
+Decodes the framed Serial stream of the gateway build (src/gateway.cpp) and
+prints one JSON object per frame, for dashboards and latency analysis.
+
+Usage: gateway_decoder.py /dev/ttyUSB0   (or any file or pty with the raw stream)
+
+Payload layouts mirror lib/common/src/common.h as laid out by the ESP8266
+compiler, padding included. Keep them in sync when payloads change.
+"""
+
+import json
+import os
+import struct
+import sys
+import termios
+import tty
+
+FRAME_SYNC = b"\xa5\x5a"
+FRAME_PACKET = 0x01
+FRAME_STATUS = 0x02
+BAUD = 921600
+
+PROTOCOL_VERSION = 3  # high nibble of the version byte
+
+# board geometries by the low nibble of the version byte, see lib/common/src/common.h
+GEOMETRIES = {0: (84, 48), 1: (128, 64)}
+BALLSIZE = 4
+BADDIE_RATE = 5
+LEVEL_FLAG = 0
+LEVEL_BADDIE = 1
+MAZE_COUNT = 4  # layouts in lib/maze/mazes.txt
+
+
+def mac(raw):
+    return ":".join("%02x" % b for b in raw)
+
+
+def mix_bits(value):
+    value ^= value >> 16
+    value = (value * 0x85ebca6b) & 0xffffffff
+    value ^= value >> 13
+    value = (value * 0xc2b2ae35) & 0xffffffff
+    value ^= value >> 16
+    return value
+
+
+def level_place(geometry, seed, level, obj, attempt):
+    """Same as levelPlace in lib/level/src/level.cpp."""
+    width, height = geometry
+    hashed = mix_bits(seed ^ mix_bits(level | obj << 8 | attempt << 16))
+    return {
+        "x": (hashed & 0xffff) % (width - 2 * BALLSIZE) + BALLSIZE,
+        "y": (hashed >> 16) % (height - 2 * BALLSIZE) + BALLSIZE,
+    }
+
+
+def level_maze(seed):
+    """Same as levelMaze in lib/level/src/level.cpp, 0 is the open board."""
+    return mix_bits(seed ^ 0x4D415A45) % (MAZE_COUNT + 1)
+
+
+def board(raw, seed, level, flag_attempt, baddie_attempts):
+    geometry = GEOMETRIES[raw[1] & 0x0f]
+    return {
+        "maze": level_maze(seed),
+        "flag": level_place(geometry, seed, level, LEVEL_FLAG, flag_attempt),
+        "baddies": [
+            level_place(geometry, seed, (i + 1) * BADDIE_RATE, LEVEL_BADDIE, baddie_attempts[i])
+            for i in range(min(level // BADDIE_RATE, len(baddie_attempts)))
+        ],
+    }
+
+
+def decode_e(raw):
+    return {"points": raw[4], "active": bool(raw[5])}
+
+
+def decode_l(raw):
+    game_session, seed = struct.unpack_from("<H2xI", raw, 4)  # the seed is 32-bit aligned
+    level = raw[12]
+    count = raw[19]
+    players = []
+    for i in range(min(count, 5)):
+        base = 20 + 16 * i
+        x, y = struct.unpack_from("<ff", raw, base + 8)
+        players.append({
+            "mac": mac(raw[base:base + 6]),
+            "points": raw[base + 6],
+            "active": bool(raw[base + 7]),
+            "ball": {"x": x, "y": y},
+        })
+    result = {"gameSession": game_session, "seed": seed, "level": level, "players": players}
+    result.update(board(raw, seed, level, raw[13], raw[14:19]))
+    return result
+
+
+def decode_p(raw):
+    x, y = struct.unpack_from("<ff", raw, 4)
+    return {"ball": {"x": x, "y": y}}
+
+
+def decode_u(raw):
+    return {
+        "level": raw[4],
+        "flagAttempt": raw[5],
+        "baddieAttempt": raw[6],
+        "winner": mac(raw[7:13]),
+    }
+
+
+def decode_f(raw):
+    return {"loser": mac(raw[4:10])}
+
+
+def decode_h(raw):
+    seed, = struct.unpack_from("<I", raw, 4)
+    level = raw[8]
+    count = raw[16]
+    players = []
+    for i in range(min(count, 5)):
+        base = 17 + 8 * i
+        players.append({
+            "mac": mac(raw[base:base + 6]),
+            "points": raw[base + 6],
+            "active": bool(raw[base + 7]),
+        })
+    result = {"seed": seed, "level": level, "timer": raw[9], "players": players}
+    result.update(board(raw, seed, level, raw[10], raw[11:16]))
+    return result
+
+
+def decode_c(raw):
+    x, y = struct.unpack_from("<ff", raw, 8)
+    return {"kind": chr(raw[4]), "level": raw[5], "ball": {"x": x, "y": y}}
+
+
+def decode_r(raw):
+    return {"claimant": mac(raw[4:10]), "kind": chr(raw[10]), "level": raw[11]}
+
+
+# header: (name, minimum size, decoder)
+PAYLOADS = {
+    "E": ("hello", 6, decode_e),
+    "L": ("board", 100, decode_l),
+    "P": ("position", 12, decode_p),
+    "U": ("levelUp", 14, decode_u),
+    "F": ("playerLost", 10, decode_f),
+    "H": ("heartbeat", 60, decode_h),
+    "C": ("claim", 16, decode_c),
+    "R": ("claimRejected", 12, decode_r),
+}
+
+
+def decode_packet(raw):
+    if len(raw) < 4:
+        return {"type": "short"}
+    header = chr(raw[0])
+    session, = struct.unpack_from("<H", raw, 2)
+    result = {"header": header, "version": raw[1] >> 4, "session": session}
+    geometry = GEOMETRIES.get(raw[1] & 0x0f)
+    if geometry:
+        result["board"] = "%dx%d" % geometry
+    if header not in PAYLOADS:
+        result["type"] = "unknown"
+        return result
+    name, size, decoder = PAYLOADS[header]
+    result["type"] = name
+    if raw[1] >> 4 == PROTOCOL_VERSION and geometry and len(raw) >= size:
+        result.update(decoder(raw))
+    return result
+
+
+def decode_frame(frame_type, body):
+    if frame_type == FRAME_PACKET and len(body) >= 11:
+        time, = struct.unpack_from("<I", body, 0)
+        result = {"frame": "packet", "time": time, "from": mac(body[4:10]), "channel": body[10]}
+        result.update(decode_packet(body[11:]))
+        return result
+    if frame_type == FRAME_STATUS and len(body) >= 9:
+        time, dropped, session = struct.unpack_from("<IHH", body, 0)
+        return {"frame": "status", "time": time, "dropped": dropped, "session": session, "channel": body[8]}
+    return {"frame": "unknown", "type": frame_type}
+
+
+def plausible(frame_type, length):
+    """Whether a frame of this type can have this length."""
+    if frame_type == FRAME_PACKET:
+        return length >= 11 + 4  # time, MAC, channel and a packet header
+    if frame_type == FRAME_STATUS:
+        return length == 9
+    return False
+
+
+def frames(stream):
+    """Yields (type, body) of each valid frame, resynchronizing after garbage."""
+    buffer = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buffer.extend(chunk)
+        while True:
+            start = buffer.find(FRAME_SYNC)
+            if start < 0:
+                del buffer[:-1]
+                break
+            del buffer[:start]
+            if len(buffer) < 4:
+                break
+            frame_type, length = buffer[2], buffer[3]
+            if not plausible(frame_type, length):
+                del buffer[:1]  # sync bytes inside garbage, don't wait for a frame that isn't there
+                continue
+            if len(buffer) < 5 + length:
+                break
+            checksum = sum(buffer[2:4 + length]) & 0xff
+            if checksum != buffer[4 + length]:
+                del buffer[:1]  # not a real frame start, look for the next one
+                continue
+            body = bytes(buffer[4:4 + length])
+            del buffer[:5 + length]
+            yield frame_type, body
+
+
+def open_stream(path):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%d" % BAUD, None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return os.fdopen(fd, "rb", buffering=0)
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write("usage: %s <serial port or file>\n" % argv[0])
+        return 2
+    with open_stream(argv[1]) as stream:
+        for frame_type, body in frames(stream):
+            print(json.dumps(decode_frame(frame_type, body)), flush=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
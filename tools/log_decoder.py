@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Decodes the binary event log of the game (lib/event_log) from Serial and
+prints one line per record. Any text the firmware prints directly passes
+through unchanged.
+
+Usage: log_decoder.py /dev/ttyUSB0   (or any file or pty with the raw stream)
+
+Events mirror the LOG_ defines of lib/event_log/src/event_log.h, keep them in
+sync when events are added.
+"""
+
+import os
+import struct
+import sys
+import termios
+import tty
+
+LOG_SYNC = 0xA5
+LOG_BAUD = 115200
+HEADER_SIZE = 7  # sync, event, length, millis
+
+# field formats: struct codes, or "mac" for 6 bytes
+EVENTS = {
+    0: ("dropped", [("records", "H")]),
+    1: ("resumed", []),
+    2: ("espnow_failed", []),
+    3: ("delivery_failed", [("status", "B")]),
+    4: ("replacing_master", []),
+    5: ("new_master", [("mac", "mac")]),
+    6: ("following_master", [("mac", "mac")]),
+    7: ("master_silent", [("ms", "I")]),
+    8: ("player_registering", [("mac", "mac")]),
+    9: ("players_full", [("mac", "mac")]),
+    10: ("player_added", [("index", "B")]),
+    11: ("player_removed", [("index", "B")]),
+    12: ("player_timed_out", [("mac", "mac")]),
+    13: ("player", [("index", "B"), ("mac", "mac"), ("active", "B"), ("x", "B"), ("y", "B")]),
+    14: ("player_lost", [("index", "b")]),
+    15: ("publish_player_lost", [("mac", "mac"), ("x", "B"), ("y", "B")]),
+    16: ("claim_rollback", [("kind", "c")]),
+    17: ("claim_rejected", [("mac", "mac")]),
+    18: ("board_received", [("players", "B"), ("me", "b")]),
+    19: ("hosting", [("channel", "B")]),
+    20: ("no_game_found", []),
+    21: ("first_frame", [("ms", "I")]),
+    22: ("rejected_packets", [("count", "H")]),
+    23: ("physics", [("substeps", "B"), ("us", "H"), ("max_us", "H")]),
+    # tasks are numbered in priority order, see setupTasks in src/marbluino.cpp
+    24: ("task", [("index", "B"), ("runs", "H"), ("avg_us", "H"), ("max_us", "H"), ("missed", "H")]),
+}
+
+
+def decode_fields(fields, data):
+    values, offset = [], 0
+    for name, fmt in fields:
+        if fmt == "mac":
+            raw = data[offset:offset + 6]
+            if len(raw) < 6:
+                break
+            values.append("%s=%s" % (name, ":".join("%02x" % b for b in raw)))
+            offset += 6
+            continue
+        size = struct.calcsize("<" + fmt)
+        if offset + size > len(data):
+            break
+        value = struct.unpack_from("<" + fmt, data, offset)[0]
+        if fmt == "c":
+            value = value.decode("latin-1")
+        values.append("%s=%s" % (name, value))
+        offset += size
+    return values
+
+
+def format_record(event, time, data):
+    name, fields = EVENTS.get(event, ("event_%d" % event, []))
+    values = decode_fields(fields, data) if fields else ([data.hex()] if data else [])
+    return " ".join(["%10.3f" % (time / 1000.0), name] + values)
+
+
+def lines(stream):
+    """Yields a line per record, and the text around the records line by line."""
+    buffer = bytearray()
+    text = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            if text:
+                yield text.decode("latin-1")
+            return
+        buffer.extend(chunk)
+        while buffer:
+            if buffer[0] != LOG_SYNC:
+                byte = buffer.pop(0)
+                if byte == 0x0A:
+                    yield text.decode("latin-1").rstrip("\r")
+                    text = bytearray()
+                else:
+                    text.append(byte)
+                continue
+            if len(buffer) < HEADER_SIZE:
+                break
+            length = buffer[2]
+            if len(buffer) < HEADER_SIZE + length + 1:
+                break
+            checksum = sum(buffer[1:HEADER_SIZE + length]) & 0xff
+            if checksum != buffer[HEADER_SIZE + length]:
+                text.append(buffer.pop(0))  # not a record after all
+                continue
+            event = buffer[1]
+            time = struct.unpack_from("<I", buffer, 3)[0]
+            data = bytes(buffer[HEADER_SIZE:HEADER_SIZE + length])
+            del buffer[:HEADER_SIZE + length + 1]
+            yield format_record(event, time, data)
+
+
+def open_stream(path):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = getattr(termios, "B%d" % LOG_BAUD)
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return os.fdopen(fd, "rb", buffering=0)
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write("usage: %s <serial port or file>\n" % argv[0])
+        return 2
+    with open_stream(argv[1]) as stream:
+        for line in lines(stream):
+            print(line, flush=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,21 @@
+// Just enough of the Arduino core to build the game libraries on a host
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <cstdlib>
+
+#define IRAM_ATTR
+#define PROGMEM
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define memcpy_P memcpy
+
+using std::abs;
+
+/**
+ * @return microseconds since the start of the runner
+ */
+unsigned long micros();
@@ -0,0 +1,357 @@
+/**
+ * Headless match runner: plays single player matches with a bot tilting the
+ * board, on all host cores, and prints per parameter set statistics as CSV.
+ * Physics, level generation and the spawn, collision and win rules are the
+ * firmware libraries themselves, the rest mirrors src/marbluino.cpp for a lone
+ * player.
+ *
+ * usage: match_runner [--acc 0.3,0.5] [--bounce -0.5] [--baddie-rate 5]
+ *          [--min-distance 30] [--max-timer 10] [--matches 1000]
+ *          [--maze 0,1] [--bot greedy|random] [--threads N] [--seed N]
+ *
+ * Without --maze every match gets the maze its seed picks, like on the devices.
+ */
+#include <Arduino.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include "common.h"
+#include "graphic.h"
+#include "physics.h"
+#include "level.h"
+#include "maze.h"
+
+#define FRAME_INTERVAL 50 // ms per frame, as in the firmware
+#define TIMER_INTERVAL 100 // ms per round timer tick
+#define BATCH_SIZE 16 // matches per job, small enough to balance the cores
+#define MAZE_FROM_SEED -1
+
+struct params_t {
+  float accFactor;
+  float bounceFactor;
+  uint8_t baddieRate;
+  uint8_t minDistance;
+  uint8_t maxTimer; // seconds
+  int16_t maze; // or MAZE_FROM_SEED
+};
+
+struct match_result_t {
+  uint8_t level;
+  bool timedOut;
+  bool finished; // won the round, no room left for another baddie
+  uint32_t frames; // until the last flag was reached
+  uint32_t spawns;
+  uint32_t spawnRetries;
+  uint8_t maxRetries;
+  uint32_t micros;
+};
+
+struct stats_t {
+  uint32_t matches;
+  uint64_t levels;
+  uint8_t maxLevel;
+  uint32_t timeouts;
+  uint32_t finished;
+  uint64_t flagFrames; // frames spent on the flags that were reached
+  uint64_t flags;
+  uint64_t spawns;
+  uint64_t spawnRetries;
+  uint8_t maxRetries;
+  uint64_t micros;
+  uint32_t maxMicros;
+};
+
+struct job_t {
+  uint16_t params;
+  uint32_t firstMatch;
+  uint32_t matchCount;
+};
+
+struct worker_queue_t {
+  std::mutex lock;
+  std::deque<job_t> jobs;
+};
+
+const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool randomBot = false;
+uint32_t baseSeed = 1;
+
+/**
+ * xorshift32, the bot's own dice
+ * @return uniform float in [-1, 1]
+ */
+float randomUnit(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return (float)(*state & 0xFFFF) / 0x7FFF - 1;
+}
+
+float clampUnit(float value) {
+  return value < -1 ? -1 : (value > 1 ? 1 : value);
+}
+
+/**
+ * Spawns like the firmware does, for the single ball
+ */
+uint8_t spawnAttempt(const params_t &params, uint32_t seed, uint8_t level, uint8_t object, const fpoint_t ball, uint8_t maze) {
+  return levelSpawnAttempt(seed, level, object, maze, &ball, 1, params.minDistance);
+}
+
+/**
+ * Tilt of the board chosen by the bot, in g per axis like the accelerometer
+ */
+fpoint_t botTilt(const fpoint_t ball, const fpoint_t speed, const upoint_t flag, const upoint_t baddies[], uint8_t baddiesCount, uint32_t *dice) {
+  fpoint_t tilt;
+  if (randomBot) {
+    tilt.x = randomUnit(dice);
+    tilt.y = randomUnit(dice);
+    return tilt;
+  }
+  // head for the flag, slowing down on the approach
+  fpoint_t wanted;
+  wanted.x = (flag.x - ball.x) / 8;
+  wanted.y = (flag.y - ball.y) / 8;
+  // steer clear of the baddies
+  for (uint8_t i = 0; i < baddiesCount; i++) {
+    float dx = ball.x - baddies[i].x;
+    float dy = ball.y - baddies[i].y;
+    float distance = abs(dx) + abs(dy);
+    if (distance < 12) {
+      wanted.x += dx / (distance + 1) * 2;
+      wanted.y += dy / (distance + 1) * 2;
+    }
+  }
+  // a shaky hand
+  tilt.x = clampUnit(wanted.x - speed.x + randomUnit(dice) * 0.2);
+  tilt.y = clampUnit(wanted.y - speed.y + randomUnit(dice) * 0.2);
+  return tilt;
+}
+
+match_result_t playMatch(const params_t &params, uint32_t matchSeed) {
+  match_result_t result = {};
+  uint32_t start = micros();
+  uint32_t dice = matchSeed | 1;
+  uint32_t levelSeed = mixBits(matchSeed);
+  uint8_t maze = params.maze == MAZE_FROM_SEED ? levelMaze(levelSeed) : params.maze;
+  setBounceFactor(params.bounceFactor);
+
+  fpoint_t ball, speed = {0, 0};
+  ball.x = DISPLAY_WIDTH / 2;
+  ball.y = DISPLAY_HEIGHT / 2;
+  uint8_t level = 0;
+  uint8_t baddiesCount = 0;
+  upoint_t baddies[MAX_BADDIES];
+  uint32_t framesPerTick = TIMER_INTERVAL / FRAME_INTERVAL;
+  uint32_t timer = (uint32_t)params.maxTimer * 1000 / TIMER_INTERVAL;
+
+  uint8_t attempt = spawnAttempt(params, levelSeed, level, LEVEL_FLAG, ball, maze);
+  result.spawns++;
+  result.spawnRetries += attempt;
+  result.maxRetries = attempt;
+  upoint_t flag = levelPlace(levelSeed, level, LEVEL_FLAG, attempt);
+
+  for (uint32_t frame = 1; ; frame++) {
+    fpoint_t tilt = botTilt(ball, speed, flag, baddies, baddiesCount, &dice);
+    fpoint_t acceleration;
+    acceleration.x = params.accFactor * tilt.x;
+    acceleration.y = params.accFactor * tilt.y;
+    stepPhysics(&ball, &speed, acceleration, NULL, 0, maze);
+
+    bool hit = false;
+    for (uint8_t i = 0; i < baddiesCount; i++) {
+      if (isCollided(ball, baddies[i])) hit = true;
+    }
+    if (hit) break;
+    if (isCollided(ball, flag)) {
+      result.frames = frame;
+      level++;
+      if (levelWon(level, params.baddieRate)) {
+        result.finished = true;
+        break;
+      }
+      timer = (uint32_t)params.maxTimer * 1000 / TIMER_INTERVAL;
+      attempt = spawnAttempt(params, levelSeed, level, LEVEL_FLAG, ball, maze);
+      result.spawns++;
+      result.spawnRetries += attempt;
+      if (attempt > result.maxRetries) result.maxRetries = attempt;
+      flag = levelPlace(levelSeed, level, LEVEL_FLAG, attempt);
+      if (level % params.baddieRate == 0) {
+        attempt = spawnAttempt(params, levelSeed, level, LEVEL_BADDIE, ball, maze);
+        result.spawns++;
+        result.spawnRetries += attempt;
+        if (attempt > result.maxRetries) result.maxRetries = attempt;
+        baddies[baddiesCount++] = levelPlace(levelSeed, level, LEVEL_BADDIE, attempt);
+      }
+    }
+    if (frame % framesPerTick == 0) {
+      if (timer == 0) {
+        result.timedOut = true;
+        break;
+      }
+      timer--;
+    }
+  }
+  result.level = level;
+  result.micros = micros() - start;
+  return result;
+}
+
+void addResult(stats_t *stats, const match_result_t &result) {
+  stats->matches++;
+  stats->levels += result.level;
+  if (result.level > stats->maxLevel) stats->maxLevel = result.level;
+  if (result.timedOut) stats->timeouts++;
+  if (result.finished) stats->finished++;
+  stats->flagFrames += result.frames;
+  stats->flags += result.level;
+  stats->spawns += result.spawns;
+  stats->spawnRetries += result.spawnRetries;
+  if (result.maxRetries > stats->maxRetries) stats->maxRetries = result.maxRetries;
+  stats->micros += result.micros;
+  if (result.micros > stats->maxMicros) stats->maxMicros = result.micros;
+}
+
+void mergeStats(stats_t *into, const stats_t &from) {
+  into->matches += from.matches;
+  into->levels += from.levels;
+  if (from.maxLevel > into->maxLevel) into->maxLevel = from.maxLevel;
+  into->timeouts += from.timeouts;
+  into->finished += from.finished;
+  into->flagFrames += from.flagFrames;
+  into->flags += from.flags;
+  into->spawns += from.spawns;
+  into->spawnRetries += from.spawnRetries;
+  if (from.maxRetries > into->maxRetries) into->maxRetries = from.maxRetries;
+  into->micros += from.micros;
+  if (from.maxMicros > into->maxMicros) into->maxMicros = from.maxMicros;
+}
+
+/**
+ * Takes the newest job of our own queue, or steals the oldest one of another
+ * worker when ours is empty
+ * @return false when there is no work left anywhere
+ */
+bool takeJob(std::vector<worker_queue_t> &queues, size_t self, job_t *job) {
+  for (size_t i = 0; i < queues.size(); i++) {
+    worker_queue_t &queue = queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.jobs.empty()) continue;
+    if (i == 0) {
+      *job = queue.jobs.back();
+      queue.jobs.pop_back();
+    } else {
+      *job = queue.jobs.front();
+      queue.jobs.pop_front();
+    }
+    return true;
+  }
+  return false; // jobs are never added once started, so nothing can show up later
+}
+
+void worker(std::vector<worker_queue_t> &queues, size_t self, const std::vector<params_t> &sweep, std::vector<stats_t> &stats) {
+  job_t job;
+  while (takeJob(queues, self, &job)) {
+    for (uint32_t match = job.firstMatch; match < job.firstMatch + job.matchCount; match++) {
+      // the same match number gets the same level in every parameter set
+      match_result_t result = playMatch(sweep[job.params], mixBits(baseSeed + match));
+      addResult(&stats[job.params], result);
+    }
+  }
+}
+
+/**
+ * @param list comma separated numbers
+ */
+std::vector<float> parseList(const char *list) {
+  std::vector<float> values;
+  const char *p = list;
+  while (*p) {
+    char *end;
+    values.push_back(strtof(p, &end));
+    if (end == p) break;
+    p = *end == ',' ? end + 1 : end;
+  }
+  return values;
+}
+
+int main(int argc, char **argv) {
+  std::vector<float> accFactors = {0.5}, bounceFactors = {BOUNCE_FACTOR}, baddieRates = {5}, minDistances = {30}, maxTimers = {10}, mazes = {MAZE_FROM_SEED};
+  uint32_t matches = 1000;
+  size_t threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string option = argv[i];
+    const char *value = argv[i+1];
+    if (option == "--acc") accFactors = parseList(value);
+    else if (option == "--bounce") bounceFactors = parseList(value);
+    else if (option == "--baddie-rate") baddieRates = parseList(value);
+    else if (option == "--min-distance") minDistances = parseList(value);
+    else if (option == "--max-timer") maxTimers = parseList(value);
+    else if (option == "--maze") mazes = parseList(value);
+    else if (option == "--matches") matches = strtoul(value, NULL, 10);
+    else if (option == "--threads") threads = strtoul(value, NULL, 10);
+    else if (option == "--seed") baseSeed = strtoul(value, NULL, 10);
+    else if (option == "--bot") randomBot = std::string(value) == "random";
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (threads == 0) threads = 1;
+
+  std::vector<params_t> sweep;
+  for (float acc : accFactors)
+    for (float bounce : bounceFactors)
+      for (float rate : baddieRates)
+        for (float distance : minDistances)
+          for (float maxTimer : maxTimers)
+            for (float maze : mazes) {
+              if (rate < 1 || maxTimer < 1 || maze > mazeCount()) continue;
+              sweep.push_back({acc, bounce, (uint8_t)rate, (uint8_t)distance, (uint8_t)maxTimer, (int16_t)maze});
+            }
+
+  // deal the jobs round robin, stealing evens out the slow parameter sets
+  std::vector<worker_queue_t> queues(threads);
+  size_t next = 0;
+  for (uint16_t p = 0; p < sweep.size(); p++) {
+    for (uint32_t first = 0; first < matches; first += BATCH_SIZE) {
+      uint32_t count = matches - first < BATCH_SIZE ? matches - first : BATCH_SIZE;
+      queues[next++ % threads].jobs.push_back({p, first, count});
+    }
+  }
+
+  std::vector<std::vector<stats_t>> workerStats(threads, std::vector<stats_t>(sweep.size()));
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; t++) {
+    pool.emplace_back(worker, std::ref(queues), t, std::cref(sweep), std::ref(workerStats[t]));
+  }
+  for (std::thread &thread : pool) thread.join();
+
+  printf("acc,bounce,baddie_rate,min_distance,max_timer,maze,matches,level_avg,level_max,timeouts,finished,flag_ms_avg,spawn_retries_avg,spawn_retries_max,match_us_avg,match_us_max\n");
+  for (size_t p = 0; p < sweep.size(); p++) {
+    stats_t total = {};
+    for (size_t t = 0; t < threads; t++) mergeStats(&total, workerStats[t][p]);
+    const params_t &params = sweep[p];
+    printf("%.2f,%.2f,%u,%u,%u,%s,%u,%.2f,%u,%u,%u,%.0f,%.3f,%u,%.1f,%u\n",
+      params.accFactor, params.bounceFactor, params.baddieRate, params.minDistance, params.maxTimer,
+      params.maze == MAZE_FROM_SEED ? "seed" : std::to_string(params.maze).c_str(),
+      total.matches,
+      total.matches ? (double)total.levels / total.matches : 0.0, total.maxLevel,
+      total.timeouts, total.finished,
+      total.flags ? (double)total.flagFrames * FRAME_INTERVAL / total.flags : 0.0,
+      total.spawns ? (double)total.spawnRetries / total.spawns : 0.0, total.maxRetries,
+      total.matches ? (double)total.micros / total.matches : 0.0, total.maxMicros);
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Packs the obstacle layouts of lib/maze/mazes.txt into lib/maze/src/maze_data.h.
+
+Every maze is stored the way U8g2 keeps its full frame buffer for the supported
+displays (pages of 8 rows, one byte per column, least significant bit on top),
+so drawing one is a plain copy and the collision test reads the same bits.
+Bytes go out as little endian 32-bit words, to keep the flash reads aligned.
+
+usage: maze_gen.py
+"""
+
+import os
+import struct
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SOURCE = os.path.join(ROOT, "lib", "maze", "mazes.txt")
+TARGET = os.path.join(ROOT, "lib", "maze", "src", "maze_data.h")
+
+# (define selecting the display, width, height), as in graphic.h
+DISPLAYS = [("DISPLAY_SSD1306_128X64", 128, 64), (None, 84, 48)]
+BALL_MARGIN = 3  # free pixels needed around the center, where the balls start
+
+
+def read_mazes(path):
+    mazes, rows = [], []
+    with open(path) as source:
+        for line in source:
+            line = line.strip()
+            if line.startswith(";"):
+                continue
+            if not line:
+                if rows:
+                    mazes.append(rows)
+                rows = []
+                continue
+            rows.append(line)
+    if rows:
+        mazes.append(rows)
+    for index, rows in enumerate(mazes):
+        if any(len(row) != len(rows[0]) for row in rows):
+            sys.exit("maze %d: rows differ in length" % (index + 1))
+    return mazes
+
+
+def is_wall(rows, x, y, width, height):
+    """Nearest cell of the layout for a pixel of the display."""
+    return rows[y * len(rows) // height][x * len(rows[0]) // width] == "#"
+
+
+def pack(rows, width, height):
+    stride = (width + 7) // 8 * 8
+    pages = (height + 7) // 8
+    buffer = bytearray(stride * pages)
+    for y in range(height):
+        for x in range(width):
+            if is_wall(rows, x, y, width, height):
+                buffer[y // 8 * stride + x] |= 1 << (y % 8)
+    return struct.unpack("<%dI" % (len(buffer) // 4), buffer)
+
+
+def check_center(rows, width, height, index):
+    for y in range(height // 2 - BALL_MARGIN, height // 2 + BALL_MARGIN + 1):
+        for x in range(width // 2 - BALL_MARGIN, width // 2 + BALL_MARGIN + 1):
+            if is_wall(rows, x, y, width, height):
+                sys.exit("maze %d: the center of the %dx%d board is not free" % (index + 1, width, height))
+
+
+def main():
+    mazes = read_mazes(SOURCE)
+    out = ["// Generated by tools/maze_gen.py from lib/maze/mazes.txt, do not edit", ""]
+    for define, width, height in DISPLAYS:
+        if define:
+            out.append("#if defined(%s)" % define)
+        else:
+            out.append("#else")
+        out.append("const uint32_t mazeData[][MAZE_WORDS] PROGMEM = {")
+        for index, rows in enumerate(mazes):
+            check_center(rows, width, height, index)
+            words = pack(rows, width, height)
+            out.append("  {")
+            for start in range(0, len(words), 8):
+                out.append("    " + ", ".join("0x%08x" % word for word in words[start:start + 8]) + ",")
+            out.append("  },")
+        out.append("};")
+    out.append("#endif")
+    with open(TARGET, "w") as target:
+        target.write("\n".join(out) + "\n")
+    print("%d mazes written to %s" % (len(mazes), os.path.relpath(TARGET, ROOT)))
+
+
+if __name__ == "__main__":
+    main()
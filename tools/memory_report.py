@@ -0,0 +1,85 @@
+"""
+PlatformIO extra script: after linking, prints IRAM, DRAM and flash use and
+the largest stack frame per module (src and each lib), from the object files.
+
+Stack figures come from -fstack-usage and are per function, not per call
+chain, so the worst case of a module is its deepest single frame.
+"""
+
+import glob
+import os
+import subprocess
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+env.Append(CCFLAGS=["-fstack-usage"])  # noqa: F821
+
+
+def classify(section):
+    """Maps an ESP8266 object file section to the memory it ends up in."""
+    if section.startswith((".iram", ".iram1")):
+        return "iram"
+    if section.startswith((".irom", ".text", ".literal")):
+        return "flash"
+    if section.startswith((".data", ".rodata", ".bss", "COMMON")):
+        return "dram"
+    return None
+
+
+def module_of(build_dir, path):
+    relative = os.path.relpath(path, build_dir)
+    top = relative.split(os.sep)[0]
+    if top.startswith("lib"):
+        # lib<hash>/<name>/... for libraries
+        parts = relative.split(os.sep)
+        return parts[1] if len(parts) > 2 else top
+    return top
+
+
+def section_sizes(size_tool, obj):
+    output = subprocess.check_output([size_tool, "-A", obj]).decode()
+    sizes = {"iram": 0, "dram": 0, "flash": 0}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[1].isdigit():
+            continue
+        kind = classify(fields[0])
+        if kind:
+            sizes[kind] += int(fields[1])
+    return sizes
+
+
+def max_stack(obj):
+    su = os.path.splitext(obj)[0] + ".su"
+    worst = (0, "")
+    if not os.path.exists(su):
+        return worst
+    with open(su) as lines:
+        for line in lines:
+            fields = line.split("\t")
+            if len(fields) >= 2 and fields[1].isdigit() and int(fields[1]) > worst[0]:
+                worst = (int(fields[1]), fields[0].split(":")[-1])
+    return worst
+
+
+def memory_report(source, target, env):
+    build_dir = env.subst("$BUILD_DIR")
+    size_tool = env.subst("$SIZETOOL")
+    modules = {}
+    for obj in glob.glob(os.path.join(build_dir, "**", "*.o"), recursive=True):
+        module = module_of(build_dir, obj)
+        if module.startswith("FrameworkArduino"):
+            continue
+        totals = modules.setdefault(module, {"iram": 0, "dram": 0, "flash": 0, "stack": (0, "")})
+        for kind, size in section_sizes(size_tool, obj).items():
+            totals[kind] += size
+        totals["stack"] = max(totals["stack"], max_stack(obj))
+
+    print("Memory per module (bytes):")
+    print("%-16s %8s %8s %8s %8s  %s" % ("module", "iram", "dram", "flash", "stack", "deepest frame"))
+    for module in sorted(modules):
+        t = modules[module]
+        print("%-16s %8d %8d %8d %8d  %s" % (module, t["iram"], t["dram"], t["flash"], t["stack"][0], t["stack"][1]))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", memory_report)  # noqa: F821